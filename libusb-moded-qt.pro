@@ -1,4 +1,4 @@
 TEMPLATE = subdirs
 CONFIG += ordered
-SUBDIRS += src
+SUBDIRS += src monitor qml tests
 OTHER_FILES += rpm/libusb-moded-qt5.spec
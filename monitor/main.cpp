@@ -0,0 +1,385 @@
+/*
+ * Copyright (C) 2026 Jolla Ltd.
+ *
+ * You may use this file under the terms of the BSD license as follows:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in
+ *     the documentation and/or other materials provided with the
+ *     distribution.
+ *   * Neither the name of Nemo Mobile nor the names of its contributors
+ *     may be used to endorse or promote products derived from this
+ *     software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "qusbmoded.h"
+
+#include "usb_moded-dbus.h"
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDBusConnection>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSocketNotifier>
+#include <QTextStream>
+#include <QTimer>
+
+#include <signal.h>
+#include <unistd.h>
+
+// Running min/max/mean of a series of samples
+class Stats
+{
+public:
+    Stats() : iCount(0), iMin(0), iMax(0), iSum(0) {}
+
+    void add(qint64 aValue)
+    {
+        if (!iCount || aValue < iMin) iMin = aValue;
+        if (!iCount || aValue > iMax) iMax = aValue;
+        iSum += aValue;
+        iCount++;
+    }
+
+    QString toString(const char* aUnit) const
+    {
+        if (!iCount) return QStringLiteral("n/a");
+        return QString::fromLatin1("count %1, min %2%5, mean %3%5, max %4%5").
+            arg(iCount).arg(iMin).arg(iSum / iCount).arg(iMax).
+            arg(QLatin1String(aUnit));
+    }
+
+    QJsonObject toJson() const
+    {
+        QJsonObject obj;
+        obj.insert(QStringLiteral("count"), iCount);
+        if (iCount) {
+            obj.insert(QStringLiteral("min"), double(iMin));
+            obj.insert(QStringLiteral("mean"), double(iSum) / iCount);
+            obj.insert(QStringLiteral("max"), double(iMax));
+        }
+        return obj;
+    }
+
+private:
+    int iCount;
+    qint64 iMin;
+    qint64 iMax;
+    qint64 iSum;
+};
+
+class Monitor : public QObject
+{
+    Q_OBJECT
+
+public:
+    Monitor(bool aQuiet, QObject* aParent = nullptr);
+
+    void printSummary(bool aJson);
+
+private Q_SLOTS:
+    void onAvailableChanged();
+    void onCurrentModeChanged();
+    void onTargetModeChanged();
+    void onConfigModeChanged();
+    void onSupportedModesChanged();
+    void onAvailableModesChanged();
+    void onHiddenModesChanged();
+    void onEventReceived(QString aEvent);
+    void onUsbStateError(QString aError);
+    void onRawStateChanged(QString aMode);
+    void onRawConfigChanged(QString aSect, QString aKey, QString aVal);
+
+private:
+    void print(const QString &aWhat, const QString &aValue);
+    void stateLatency(const QString &aMode, bool aRaw);
+
+private:
+    // Unmatched latency entries are dropped after this long (us)
+    static const qint64 MaxLatency = 1000000;
+
+    QElapsedTimer iClock;
+    QTextStream iOut;
+    QUsbModed* iUsbModed;
+    bool iQuiet;
+    qint64 iReadyTime;
+    qint64 iSwitchStart;
+    int iStateChanges;
+    int iEvents;
+    int iConfigChanges;
+    // Time the mode was seen on the bus (true) or as property (false)
+    QHash<QString,QPair<bool,qint64> > iPendingLatency;
+    Stats iLatency;     // us
+    Stats iSwitchTime;  // ms
+};
+
+Monitor::Monitor(bool aQuiet, QObject* aParent) :
+    QObject(aParent),
+    iOut(stdout),
+    iQuiet(aQuiet),
+    iReadyTime(-1),
+    iSwitchStart(-1),
+    iStateChanges(0),
+    iEvents(0),
+    iConfigChanges(0)
+{
+    iClock.start();
+
+    // Raw signals are watched to measure how long it takes for them
+    // to show up as QUsbModed properties
+    QDBusConnection bus(QDBusConnection::systemBus());
+    bus.connect(USB_MODE_SERVICE, USB_MODE_OBJECT, USB_MODE_INTERFACE,
+        QStringLiteral("sig_usb_current_state_ind"),
+        this, SLOT(onRawStateChanged(QString)));
+    bus.connect(USB_MODE_SERVICE, USB_MODE_OBJECT, USB_MODE_INTERFACE,
+        QStringLiteral("sig_usb_config_ind"),
+        this, SLOT(onRawConfigChanged(QString,QString,QString)));
+
+    iUsbModed = new QUsbModed(this);
+    connect(iUsbModed, &QUsbModed::availableChanged,
+            this, &Monitor::onAvailableChanged);
+    connect(iUsbModed, &QUsbModed::currentModeChanged,
+            this, &Monitor::onCurrentModeChanged);
+    connect(iUsbModed, &QUsbModed::targetModeChanged,
+            this, &Monitor::onTargetModeChanged);
+    connect(iUsbModed, &QUsbModed::configModeChanged,
+            this, &Monitor::onConfigModeChanged);
+    connect(iUsbModed, &QUsbModed::supportedModesChanged,
+            this, &Monitor::onSupportedModesChanged);
+    connect(iUsbModed, &QUsbModed::availableModesChanged,
+            this, &Monitor::onAvailableModesChanged);
+    connect(iUsbModed, &QUsbModed::hiddenModesChanged,
+            this, &Monitor::onHiddenModesChanged);
+    connect(iUsbModed, &QUsbModed::eventReceived,
+            this, &Monitor::onEventReceived);
+    connect(iUsbModed, &QUsbModed::usbStateError,
+            this, &Monitor::onUsbStateError);
+}
+
+void Monitor::print(const QString &aWhat, const QString &aValue)
+{
+    if (!iQuiet) {
+        const qint64 ms = iClock.elapsed();
+        iOut << QString::fromLatin1("[%1.%2] ").
+            arg(ms / 1000, 6).arg(ms % 1000, 3, 10, QLatin1Char('0')) <<
+            aWhat << ": " << aValue << '\n';
+        iOut.flush();
+    }
+}
+
+void Monitor::onAvailableChanged()
+{
+    const bool available = iUsbModed->available();
+    if (available && iReadyTime < 0) {
+        iReadyTime = iClock.elapsed();
+    }
+    print(QStringLiteral("available"), available ?
+        QStringLiteral("true") : QStringLiteral("false"));
+}
+
+void Monitor::onCurrentModeChanged()
+{
+    const QString mode(iUsbModed->currentMode());
+    iStateChanges++;
+    print(QStringLiteral("current"), mode);
+    if (iReadyTime >= 0) {
+        // Setup replies don't have a matching signal
+        stateLatency(mode, false);
+    }
+    if (iSwitchStart >= 0 && mode == iUsbModed->targetMode() &&
+        QUsbMode::isFinalState(mode)) {
+        const qint64 duration = iClock.elapsed() - iSwitchStart;
+        iSwitchTime.add(duration);
+        iSwitchStart = -1;
+        print(QStringLiteral("switch"), QString::fromLatin1("%1 took %2 ms").
+            arg(mode).arg(duration));
+    }
+}
+
+void Monitor::onTargetModeChanged()
+{
+    const QString mode(iUsbModed->targetMode());
+    print(QStringLiteral("target"), mode);
+    if (iReadyTime >= 0 && mode != iUsbModed->currentMode()) {
+        iSwitchStart = iClock.elapsed();
+    }
+}
+
+void Monitor::onConfigModeChanged()
+{
+    print(QStringLiteral("config"), iUsbModed->configMode());
+}
+
+void Monitor::onSupportedModesChanged()
+{
+    print(QStringLiteral("supported"), iUsbModed->supportedModes().join(','));
+}
+
+void Monitor::onAvailableModesChanged()
+{
+    print(QStringLiteral("available modes"), iUsbModed->availableModes().join(','));
+}
+
+void Monitor::onHiddenModesChanged()
+{
+    print(QStringLiteral("hidden"), iUsbModed->hiddenModes().join(','));
+}
+
+void Monitor::onEventReceived(QString aEvent)
+{
+    iEvents++;
+    print(QStringLiteral("event"), aEvent);
+}
+
+void Monitor::onUsbStateError(QString aError)
+{
+    print(QStringLiteral("error"), aError);
+}
+
+void Monitor::onRawStateChanged(QString aMode)
+{
+    stateLatency(aMode, true);
+}
+
+void Monitor::onRawConfigChanged(QString aSect, QString aKey, QString aVal)
+{
+    iConfigChanges++;
+    print(QStringLiteral("config ") + aSect + '/' + aKey, aVal);
+}
+
+void Monitor::stateLatency(const QString &aMode, bool aRaw)
+{
+    // Delivery order of the same D-Bus signal to the two receivers isn't
+    // defined, whichever comes first waits for the other one. Only the
+    // raw signal coming first gives a sample, the other way around the
+    // latency isn't known.
+    const qint64 now = iClock.nsecsElapsed() / 1000;
+    auto it = iPendingLatency.begin();
+    while (it != iPendingLatency.end()) {
+        if (now - it->second > MaxLatency) {
+            it = iPendingLatency.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    it = iPendingLatency.find(aMode);
+    if (it != iPendingLatency.end() && it->first != aRaw) {
+        if (!aRaw) {
+            iLatency.add(now - it->second);
+        }
+        iPendingLatency.erase(it);
+    } else if (aRaw && aMode == iUsbModed->currentMode()) {
+        // Repeats the current mode, the property isn't going to change
+    } else {
+        iPendingLatency.insert(aMode, qMakePair(aRaw, now));
+    }
+}
+
+void Monitor::printSummary(bool aJson)
+{
+    const qint64 uptime = iClock.elapsed();
+    if (aJson) {
+        QJsonObject obj;
+        obj.insert(QStringLiteral("uptime_ms"), double(uptime));
+        obj.insert(QStringLiteral("ready_ms"), double(iReadyTime));
+        obj.insert(QStringLiteral("state_changes"), iStateChanges);
+        obj.insert(QStringLiteral("events"), iEvents);
+        obj.insert(QStringLiteral("config_changes"), iConfigChanges);
+        obj.insert(QStringLiteral("signal_latency_us"), iLatency.toJson());
+        obj.insert(QStringLiteral("mode_switch_ms"), iSwitchTime.toJson());
+        iOut << QJsonDocument(obj).toJson();
+    } else {
+        iOut << "uptime: " << uptime << " ms\n";
+        iOut << "ready: ";
+        if (iReadyTime >= 0) {
+            iOut << iReadyTime << " ms\n";
+        } else {
+            iOut << "never\n";
+        }
+        iOut << "state changes: " << iStateChanges << '\n';
+        iOut << "events: " << iEvents << '\n';
+        iOut << "config changes: " << iConfigChanges << '\n';
+        iOut << "signal latency: " << iLatency.toString("us") << '\n';
+        iOut << "mode switch: " << iSwitchTime.toString("ms") << '\n';
+    }
+    iOut.flush();
+}
+
+static int signalPipe[2];
+
+static void signalHandler(int)
+{
+    const char c = 0;
+    if (write(signalPipe[1], &c, 1) < 0) {
+        // Nothing we can do about it
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    QCoreApplication app(argc, argv);
+    app.setApplicationName(QStringLiteral("usb-moded-qt-monitor"));
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QStringLiteral(
+        "Streams usb_moded state changes and collects timing statistics."));
+    parser.addHelpOption();
+    QCommandLineOption jsonOption(QStringList() << "j" << "json",
+        QStringLiteral("Print the summary as JSON."));
+    QCommandLineOption quietOption(QStringList() << "q" << "quiet",
+        QStringLiteral("Don't print the changes, only the summary."));
+    QCommandLineOption timeOption(QStringList() << "t" << "time",
+        QStringLiteral("Exit after <seconds>."), QStringLiteral("seconds"));
+    parser.addOption(jsonOption);
+    parser.addOption(quietOption);
+    parser.addOption(timeOption);
+    parser.process(app);
+
+    if (pipe(signalPipe) == 0) {
+        QSocketNotifier* notifier = new QSocketNotifier(signalPipe[0],
+            QSocketNotifier::Read, &app);
+        QObject::connect(notifier, &QSocketNotifier::activated,
+            &app, &QCoreApplication::quit);
+        signal(SIGINT, signalHandler);
+        signal(SIGTERM, signalHandler);
+    }
+
+    if (parser.isSet(timeOption)) {
+        bool ok = false;
+        const int sec = parser.value(timeOption).toInt(&ok);
+        if (!ok || sec <= 0) {
+            parser.showHelp(1);
+        }
+        QTimer::singleShot(sec * 1000, &app, &QCoreApplication::quit);
+    }
+
+    Monitor monitor(parser.isSet(quietOption));
+    const int ret = app.exec();
+    monitor.printSummary(parser.isSet(jsonOption));
+    return ret;
+}
+
+#include "main.moc"
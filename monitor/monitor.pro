@@ -0,0 +1,16 @@
+TEMPLATE = app
+TARGET = usb-moded-qt-monitor
+CONFIG += link_pkgconfig
+PKGCONFIG += usb_moded
+
+QT += dbus
+QT -= gui
+
+INCLUDEPATH += ../src
+LIBS += -L$$OUT_PWD/../src -lusb-moded-qt$${QT_MAJOR_VERSION}
+
+SOURCES += \
+    main.cpp
+
+target.path = /usr/bin
+INSTALLS += target
@@ -0,0 +1,24 @@
+TEMPLATE = lib
+TARGET = usbmodedqmlplugin
+TARGET = $$qtLibraryTarget($$TARGET)
+CONFIG += plugin
+
+QT += qml dbus
+QT -= gui
+
+INCLUDEPATH += ../src
+LIBS += -L$$OUT_PWD/../src -lusb-moded-qt$${QT_MAJOR_VERSION}
+
+SOURCES += \
+    plugin.cpp
+
+OTHER_FILES += \
+    qmldir
+
+MODULENAME = Nemo/UsbModed
+target.path = $$[QT_INSTALL_QML]/$$MODULENAME
+
+qmldir.files = qmldir
+qmldir.path = $$target.path
+
+INSTALLS += target qmldir
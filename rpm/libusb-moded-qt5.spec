@@ -13,6 +13,8 @@ Requires:       usb-moded >= 0.86.0+mer39
 BuildRequires:  usb-moded-devel >= 0.86.0+mer39
 BuildRequires:  pkgconfig(Qt5Core)
 BuildRequires:  pkgconfig(Qt5DBus)
+BuildRequires:  pkgconfig(Qt5Qml)
+BuildRequires:  pkgconfig(Qt5Test)
 BuildRequires:  pkgconfig(usb_moded)
 
 %{!?qtc_qmake5:%define qtc_qmake5 %qmake5}
@@ -28,6 +30,21 @@ Requires:   %{name} = %{version}-%{release}
 %description devel
 This package contains the development header files for usb_moded Qt bindings.
 
+%package tools
+Summary:    Command line tools for usb_moded Qt bindings
+Requires:   %{name} = %{version}-%{release}
+
+%description tools
+This package contains usb-moded-qt-monitor, a tool that streams usb_moded
+state changes and reports timing statistics.
+
+%package -n qt5-qml-plugin-nemo-usbmoded
+Summary:    QML plugin for usb_moded Qt bindings
+Requires:   %{name} = %{version}-%{release}
+
+%description -n qt5-qml-plugin-nemo-usbmoded
+This package contains the Nemo.UsbModed QML module.
+
 %prep
 %setup -q -n %{name}-%{version}
 
@@ -50,3 +67,9 @@ This package contains the development header files for usb_moded Qt bindings.
 %{_libdir}/pkgconfig/usb-moded-qt5.pc
 %{_libdir}/%{name}.so
 %{_includedir}/usb-moded-qt5/*.h
+
+%files tools
+%{_bindir}/usb-moded-qt-monitor
+
+%files -n qt5-qml-plugin-nemo-usbmoded
+%{_libdir}/qt5/qml/Nemo/UsbModed
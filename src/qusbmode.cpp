@@ -36,6 +36,8 @@
 #include "usb_moded-dbus.h"
 #include "usb_moded-modes.h"
 
+#include <QHash>
+
 // States (from usb_moded-dbus.h)
 const QString QUsbMode::Mode::Connected(USB_CONNECTED);
 const QString QUsbMode::Mode::DataInUse(DATA_IN_USE);
@@ -133,3 +135,83 @@ bool QUsbMode::isConnected(const QString &modeName)
     // Note that "busy" indicates neither connected nor disconnected.
     return !isDisconnected(modeName) && modeName != QUsbMode::Mode::Busy;
 }
+
+QUsbMode::ModeId QUsbMode::modeId(const QString &modeName)
+{
+    static const QHash<QString,ModeId> ids([]() {
+        QHash<QString,ModeId> map;
+        for (int id = IdUnknown + 1; id <= IdBusy; id++) {
+            map.insert(QUsbMode::modeName(ModeId(id)), ModeId(id));
+        }
+        return map;
+    }());
+    return ids.value(modeName, IdUnknown);
+}
+
+QString QUsbMode::modeName(ModeId id)
+{
+    switch (id) {
+    case IdConnected: return QUsbMode::Mode::Connected;
+    case IdDataInUse: return QUsbMode::Mode::DataInUse;
+    case IdDisconnected: return QUsbMode::Mode::Disconnected;
+    case IdModeRequest: return QUsbMode::Mode::ModeRequest;
+    case IdPreUnmount: return QUsbMode::Mode::PreUnmount;
+    case IdReMountFailed: return QUsbMode::Mode::ReMountFailed;
+    case IdModeSettingFailed: return QUsbMode::Mode::ModeSettingFailed;
+    case IdChargerConnected: return QUsbMode::Mode::ChargerConnected;
+    case IdChargerDisconnected: return QUsbMode::Mode::ChargerDisconnected;
+    case IdUndefined: return QUsbMode::Mode::Undefined;
+    case IdAsk: return QUsbMode::Mode::Ask;
+    case IdMassStorage: return QUsbMode::Mode::MassStorage;
+    case IdDeveloper: return QUsbMode::Mode::Developer;
+    case IdMTP: return QUsbMode::Mode::MTP;
+    case IdHost: return QUsbMode::Mode::Host;
+    case IdConnectionSharing: return QUsbMode::Mode::ConnectionSharing;
+    case IdDiag: return QUsbMode::Mode::Diag;
+    case IdAdb: return QUsbMode::Mode::Adb;
+    case IdPCSuite: return QUsbMode::Mode::PCSuite;
+    case IdCharging: return QUsbMode::Mode::Charging;
+    case IdCharger: return QUsbMode::Mode::Charger;
+    case IdChargingFallback: return QUsbMode::Mode::ChargingFallback;
+    case IdBusy: return QUsbMode::Mode::Busy;
+    case IdUnknown: break;
+    }
+    return QString();
+}
+
+// The classifiers below must agree with their string counterparts.
+// Unknown (configuration defined) modes are final states.
+
+bool QUsbMode::isEventId(ModeId id)
+{
+    return id >= IdConnected && id <= IdChargerDisconnected;
+}
+
+bool QUsbMode::isStateId(ModeId id)
+{
+    return !isEventId(id);
+}
+
+bool QUsbMode::isWaitingStateId(ModeId id)
+{
+    return (id == IdBusy ||
+            id == IdChargingFallback ||
+            id == IdAsk);
+}
+
+bool QUsbMode::isFinalStateId(ModeId id)
+{
+    return isStateId(id) && !isWaitingStateId(id);
+}
+
+bool QUsbMode::isDisconnectedId(ModeId id)
+{
+    return (id == IdDisconnected ||
+            id == IdChargerDisconnected ||
+            id == IdUndefined);
+}
+
+bool QUsbMode::isConnectedId(ModeId id)
+{
+    return !isDisconnectedId(id) && id != IdBusy;
+}
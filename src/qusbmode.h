@@ -70,6 +70,40 @@ class QUSBMODED_EXPORT QUsbMode : public QObject
     Q_PROPERTY(QString MODE_BUSY READ MODE_BUSY CONSTANT)
 
 public:
+    // Interned identifiers of the predefined modes. Modes defined by
+    // the configuration files map to IdUnknown.
+    enum ModeId {
+        IdUnknown,
+
+        // Transient Modes / "Events"
+        IdConnected,
+        IdDataInUse,
+        IdDisconnected,
+        IdModeRequest,
+        IdPreUnmount,
+        IdReMountFailed,
+        IdModeSettingFailed,
+        IdChargerConnected,
+        IdChargerDisconnected,
+
+        // Persistent Modes / "States"
+        IdUndefined,
+        IdAsk,
+        IdMassStorage,
+        IdDeveloper,
+        IdMTP,
+        IdHost,
+        IdConnectionSharing,
+        IdDiag,
+        IdAdb,
+        IdPCSuite,
+        IdCharging,
+        IdCharger,
+        IdChargingFallback,
+        IdBusy
+    };
+    Q_ENUM(ModeId)
+
     class Mode {
     public:
         // Transient Modes / "Events" (from usb_moded-dbus.h)
@@ -112,6 +146,15 @@ public:
     Q_INVOKABLE static bool isConnected(const QString &modeName);
     Q_INVOKABLE static bool isDisconnected(const QString &modeName);
 
+    Q_INVOKABLE static ModeId modeId(const QString &modeName);
+    Q_INVOKABLE static QString modeName(ModeId id);
+    Q_INVOKABLE static bool isEventId(ModeId id);
+    Q_INVOKABLE static bool isStateId(ModeId id);
+    Q_INVOKABLE static bool isWaitingStateId(ModeId id);
+    Q_INVOKABLE static bool isFinalStateId(ModeId id);
+    Q_INVOKABLE static bool isConnectedId(ModeId id);
+    Q_INVOKABLE static bool isDisconnectedId(ModeId id);
+
 private:
     // Getters for QML constants
     QString USB_CONNECTED() const { return Mode::Connected; }
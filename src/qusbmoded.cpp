@@ -32,11 +32,24 @@
  */
 
 #include "qusbmoded.h"
+#include "qusbmodedclock.h"
+#include "qusbmodedconfigvalue.h"
 #include "usb_moded_interface.h"
 
 #include "usb_moded-dbus.h"
 
+#include <QHash>
 #include <QLoggingCategory>
+#include <QMutex>
+#include <QPair>
+#include <QPointer>
+#include <QSet>
+#include <QSharedPointer>
+#include <QThread>
+
+#include <functional>
+
+#include <string.h>
 
 Q_LOGGING_CATEGORY(lcQusb, "qusbmoded", QtWarningMsg)
 
@@ -47,53 +60,401 @@ Q_LOGGING_CATEGORY(lcQusb, "qusbmoded", QtWarningMsg)
 #define USB_MODED_CALL_GET_AVAILABLE_MODES (0x10)
 #define USB_MODED_CALL_GET_TARGET_MODE (0x20)
 
+// Mode names and config keys are interned so that all instances share
+// the same string data. The table is capped, usb_moded may send arbitrary
+// garbage. This takes a process wide lock, so it's only done for values
+// that are actually going to be stored.
+static QString internMode(const QString &aMode)
+{
+    static QMutex lock;
+    static QHash<QString,QString> table;
+    QMutexLocker locker(&lock);
+    auto it = table.constFind(aMode);
+    if (it != table.constEnd()) {
+        return it.value();
+    } else if (table.count() < 256) {
+        table.insert(aMode, aMode);
+    }
+    return aMode;
+}
+
+// Service watcher and D-Bus proxy shared by all QUsbModed instances
+// using the same bus connection in the same thread
+class QUsbModedConnection
+{
+public:
+    static QUsbModedConnection* ref(const QDBusConnection &aBus);
+    void unref();
+
+    QDBusServiceWatcher* iWatcher;
+    QUsbModedInterface* iInterface;
+    bool iRegistered;
+
+private:
+    typedef QHash<QString,QUsbModedConnection*> Registry;
+
+    QUsbModedConnection(const QDBusConnection &aBus, const QString &aKey);
+    ~QUsbModedConnection();
+
+    static QMutex* registryLock();
+    static Registry* registry();
+
+private:
+    const QString iKey;
+    int iRefCount;
+};
+
+QUsbModedConnection::QUsbModedConnection(const QDBusConnection &aBus,
+    const QString &aKey) :
+    iWatcher(new QDBusServiceWatcher(USB_MODE_SERVICE, aBus,
+        QDBusServiceWatcher::WatchForRegistration |
+        QDBusServiceWatcher::WatchForUnregistration)),
+    iInterface(new QUsbModedInterface(USB_MODE_SERVICE, USB_MODE_OBJECT, aBus)),
+    iRegistered(aBus.isConnected() &&
+        aBus.interface()->isServiceRegistered(USB_MODE_SERVICE)),
+    iKey(aKey),
+    iRefCount(1)
+{
+    // These are connected before any QUsbModed gets to connect its slots
+    QObject::connect(iWatcher, &QDBusServiceWatcher::serviceRegistered,
+        iWatcher, [this]() { iRegistered = true; });
+    QObject::connect(iWatcher, &QDBusServiceWatcher::serviceUnregistered,
+        iWatcher, [this]() { iRegistered = false; });
+}
+
+QUsbModedConnection::~QUsbModedConnection()
+{
+    delete iInterface;
+    delete iWatcher;
+}
+
+QMutex* QUsbModedConnection::registryLock()
+{
+    static QMutex lock;
+    return &lock;
+}
+
+QUsbModedConnection::Registry* QUsbModedConnection::registry()
+{
+    static Registry connections;
+    return &connections;
+}
+
+QUsbModedConnection* QUsbModedConnection::ref(const QDBusConnection &aBus)
+{
+    const QString key(aBus.name() + QLatin1Char('/') +
+        QString::number(quintptr(QThread::currentThread()), 16));
+    QMutexLocker locker(registryLock());
+    QUsbModedConnection* connection = registry()->value(key);
+    if (connection) {
+        connection->iRefCount++;
+    } else {
+        connection = new QUsbModedConnection(aBus, key);
+        registry()->insert(key, connection);
+    }
+    return connection;
+}
+
+void QUsbModedConnection::unref()
+{
+    QMutexLocker locker(registryLock());
+    if (!--iRefCount) {
+        registry()->remove(iKey);
+        delete this;
+    }
+}
+
 class QUsbModed::Private
 {
 public:
     static const QString UsbModeSection;
     static const QString UsbModeKeyMode;
 
+    // Watchdog parameters, in milliseconds
+    static const int WatchdogMinInterval = 2000;
+    static const int WatchdogMaxInterval = 60000;
+    static const int WatchdogDegradedLatency = 1000;
+    static const int WatchdogStallTimeout = 5000;
+
+    class ModeBatch {
+    public:
+        ModeBatch(bool aHide) : iHide(aHide), iPending(0) {}
+
+        bool iHide;
+        int iPending;
+        QStringList iFailed;
+    };
+
+    // Section and key. The strings stored in the table are interned,
+    // so that all instances share them.
+    typedef QPair<QString,QString> ConfigKey;
+
+    class ConfigEntry {
+    public:
+        ConfigEntry() : iValid(false), iGeneration(0) {}
+
+        QString iValue;
+        bool iValid;
+        uint iGeneration;
+        QList<QUsbModedConfigValue*> iSubscribers;
+    };
+
+    typedef std::function<QDBusPendingCall()> CallStart;
+    typedef std::function<void(QDBusPendingCallWatcher*)> CallFinished;
+
+    class QueuedCall {
+    public:
+        QueuedCall(CallStart aStart, CallFinished aFinished, qint64 aQueued) :
+            iStart(aStart), iFinished(aFinished), iQueued(aQueued) {}
+
+        CallStart iStart;
+        CallFinished iFinished;
+        qint64 iQueued;
+    };
+
+    QHash<ConfigKey,ConfigEntry> iConfig;
+    QList<QueuedCall> iCallQueue[CallPriorityCount];
     QStringList iSupportedModes;
     QStringList iAvailableModes;
     QStringList iHiddenModes;
     QString iConfigMode;
     QString iCurrentMode;
     QString iTargetMode;
-    QUsbModedInterface* iInterface;
+    QString iSwitchMode;
+    QUsbModed* iOwner;
+    QUsbModedConnection* iConnection;
+    QUsbModedInterface* iInterface; // Non-null while usb_moded is there
+    QUsbModedClock* iClock;
+    QUsbModedTimer* iSwitchTimer;
+    QUsbModedTimer* iSettleTimer;
+    QUsbModedTimer* iWatchdogTimer;
+    QDBusPendingCallWatcher* iProbeCall;
+    qint64 iProbeTime;
+    Health iHealth;
+    int iProbeInterval;
+    int iProbeLatency;
+    int iUserCalls;
+    int iOutstandingCalls;
+    int iMaxPendingCalls;
+    int iSchedulingDelay[CallPriorityCount];
+    int iMaxSchedulingDelay[CallPriorityCount];
+    uint iSwitchSerial;
     int iPendingCalls;
+    int iModeBatches;
+    int iConnectSettleTime;
+    int iDisconnectSettleTime;
+    int iSuppressedFlaps;
     bool iAvailable;
+    bool iSwitchPending;
+    bool iHiddenModesChangePending;
+    bool iCableConnected;
+    bool iDebouncedConnected;
+    uint iStateVersion;
+    uint iPropertyVersion[StatePropertyCount];
+    uint iConfigGeneration;
 
-    Private() :
+    Private(QUsbModed* aOwner) :
+        iOwner(aOwner),
+        iConnection(nullptr),
         iInterface(nullptr),
+        iClock(QUsbModedClock::system()),
+        iSwitchTimer(nullptr),
+        iSettleTimer(nullptr),
+        iWatchdogTimer(nullptr),
+        iProbeCall(nullptr),
+        iProbeTime(0),
+        iHealth(HealthUnknown),
+        iProbeInterval(WatchdogMinInterval),
+        iProbeLatency(-1),
+        iUserCalls(0),
+        iOutstandingCalls(0),
+        iMaxPendingCalls(DefaultMaxPendingCalls),
+        iSwitchSerial(0),
         iPendingCalls(0),
-        iAvailable(false) {}
+        iModeBatches(0),
+        iConnectSettleTime(0),
+        iDisconnectSettleTime(0),
+        iSuppressedFlaps(0),
+        iAvailable(false),
+        iSwitchPending(false),
+        iHiddenModesChangePending(false),
+        iCableConnected(false),
+        iDebouncedConnected(false),
+        iStateVersion(0),
+        iConfigGeneration(0)
+    {
+        memset(iPropertyVersion, 0, sizeof(iPropertyVersion));
+        memset(iSchedulingDelay, 0, sizeof(iSchedulingDelay));
+        memset(iMaxSchedulingDelay, 0, sizeof(iMaxSchedulingDelay));
+    }
+
+    void scheduleCall(CallPriority aPriority, CallStart aStart, CallFinished aFinished)
+    {
+        iCallQueue[aPriority].append(QueuedCall(aStart, aFinished, iClock->now()));
+        dispatchCalls();
+    }
+
+    void dispatchCalls();
+    void dropQueuedCalls();
+
+    static QStringList parseModes(const QString &aModes);
+    static QStringList internModes(const QStringList &aModes);
+
+    void propertyChanged(StateProperty aProperty)
+    {
+        iPropertyVersion[aProperty]++;
+        iStateVersion++;
+    }
 };
 
+void QUsbModed::Private::dispatchCalls()
+{
+    // User calls go out right away, background ones only while there
+    // are less than iMaxPendingCalls calls in flight and no user call
+    // is waiting. The interface may be gone by the time a queued call
+    // gets its turn, in which case it's dropped.
+    while (iInterface) {
+        int priority;
+        if (!iCallQueue[UserCallPriority].isEmpty()) {
+            priority = UserCallPriority;
+        } else if (!iCallQueue[BackgroundCallPriority].isEmpty() &&
+                   iOutstandingCalls < iMaxPendingCalls) {
+            priority = BackgroundCallPriority;
+        } else {
+            break;
+        }
+
+        const QueuedCall call(iCallQueue[priority].takeFirst());
+        const int delay = int(qMax(iClock->now() - call.iQueued, Q_INT64_C(0)));
+        iSchedulingDelay[priority] = delay;
+        iMaxSchedulingDelay[priority] = qMax(iMaxSchedulingDelay[priority], delay);
+
+        auto *pendingCall = new QDBusPendingCallWatcher(call.iStart(), iOwner);
+        iOutstandingCalls++;
+        QObject::connect(pendingCall, &QDBusPendingCallWatcher::finished, iOwner, [this]() {
+            iOutstandingCalls--;
+            dispatchCalls();
+        });
+        QObject::connect(pendingCall, &QDBusPendingCallWatcher::finished, iOwner, call.iFinished);
+        if (priority == UserCallPriority) {
+            iOwner->userCallStarted(pendingCall);
+        }
+    }
+}
+
+QStringList QUsbModed::Private::parseModes(const QString &aModes)
+{
+    // Comma separated list as it comes from usb_moded. Whitespace around
+    // the names is ignored, so are the entries that end up empty. The
+    // first occurrence of each name determines the order. Long lists
+    // (custom configs can produce those) are deduplicated with a hash
+    // to keep the whole thing linear.
+#if QT_VERSION < QT_VERSION_CHECK(5, 14, 0)
+    const QStringList result = aModes.split(',', QString::SkipEmptyParts);
+#else
+    const QStringList result = aModes.split(',', Qt::SkipEmptyParts);
+#endif
+    const int n = result.count();
+    const bool useHash = (n > 16);
+    QSet<QString> seen;
+    QStringList modes;
+    modes.reserve(n);
+    for (int i=0; i<n; i++) {
+        const QString mode(result.at(i).trimmed());
+        if (!mode.isEmpty()) {
+            if (useHash) {
+                if (seen.contains(mode)) continue;
+                seen.insert(mode);
+            } else if (modes.contains(mode)) {
+                continue;
+            }
+            modes.append(mode);
+        }
+    }
+    return modes;
+}
+
+QStringList QUsbModed::Private::internModes(const QStringList &aModes)
+{
+    QStringList modes;
+    const int n = aModes.count();
+    modes.reserve(n);
+    for (int i=0; i<n; i++) {
+        modes.append(internMode(aModes.at(i)));
+    }
+    return modes;
+}
+
+void QUsbModed::Private::dropQueuedCalls()
+{
+    for (int i = 0; i < CallPriorityCount; i++) {
+        iCallQueue[i].clear();
+    }
+}
+
 // Groups and keys (usb_moded-config.h)
 const QString QUsbModed::Private::UsbModeSection("usbmode");
 const QString QUsbModed::Private::UsbModeKeyMode("mode");
 
 QUsbModed::QUsbModed(QObject* aParent)
     : QUsbMode(aParent)
-    , iPrivate(new Private)
+    , iPrivate(new Private(this))
 {
-    QDBusServiceWatcher* serviceWatcher =
-        new QDBusServiceWatcher(USB_MODE_SERVICE, QDBusConnection::systemBus(),
-            QDBusServiceWatcher::WatchForRegistration |
-            QDBusServiceWatcher::WatchForUnregistration, this);
+    init(QDBusConnection::systemBus());
+}
 
+QUsbModed::QUsbModed(const QDBusConnection &aBus, QObject* aParent)
+    : QUsbMode(aParent)
+    , iPrivate(new Private(this))
+{
+    init(aBus);
+}
+
+void QUsbModed::init(const QDBusConnection &aBus)
+{
+    iPrivate->iConnection = QUsbModedConnection::ref(aBus);
+
+    QDBusServiceWatcher* serviceWatcher = iPrivate->iConnection->iWatcher;
     connect(serviceWatcher, &QDBusServiceWatcher::serviceRegistered,
             this, &QUsbModed::onServiceRegistered);
     connect(serviceWatcher, &QDBusServiceWatcher::serviceUnregistered,
             this, &QUsbModed::onServiceUnregistered);
 
-    if (QDBusConnection::systemBus().interface()->isServiceRegistered(USB_MODE_SERVICE)) {
+    QUsbModedInterface* proxy = iPrivate->iConnection->iInterface;
+    connect(proxy,
+        SIGNAL(sig_usb_target_state_ind(QString)),
+        SLOT(onUsbTargetStateChanged(QString)));
+    connect(proxy,
+        SIGNAL(sig_usb_current_state_ind(QString)),
+        SLOT(onUsbStateChanged(QString)));
+    connect(proxy,
+        SIGNAL(sig_usb_event_ind(QString)),
+        SLOT(onUsbEventReceived(QString)));
+    connect(proxy,
+        SIGNAL(sig_usb_config_ind(QString,QString,QString)),
+        SLOT(onUsbConfigChanged(QString,QString,QString)));
+    connect(proxy,
+        SIGNAL(sig_usb_supported_modes_ind(QString)),
+        SLOT(onUsbSupportedModesChanged(QString)));
+    connect(proxy,
+            &QUsbModedInterface::sig_usb_available_modes_ind,
+            this,
+            &QUsbModed::checkAvailableModesForUser);
+    connect(proxy,
+        SIGNAL(sig_usb_hidden_modes_ind(QString)),
+        SLOT(onUsbHiddenModesChanged(QString)));
+    connect(proxy,
+        SIGNAL(sig_usb_state_error_ind(QString)),
+        SIGNAL(usbStateError(QString)));
+
+    if (iPrivate->iConnection->iRegistered) {
         setup();
     }
 }
 
 QUsbModed::~QUsbModed()
 {
+    iPrivate->iConnection->unref();
     delete iPrivate;
 }
 
@@ -132,134 +493,621 @@ QString QUsbModed::configMode() const
     return iPrivate->iConfigMode;
 }
 
-bool QUsbModed::setCurrentMode(QString aMode)
+uint QUsbModed::stateVersion() const
+{
+    return iPrivate->iStateVersion;
+}
+
+uint QUsbModed::stateVersion(StateProperty aProperty) const
+{
+    return (aProperty >= 0 && aProperty < StatePropertyCount) ?
+        iPrivate->iPropertyVersion[aProperty] : 0;
+}
+
+QUsbMode::ModeId QUsbModed::currentModeId() const
+{
+    return modeId(iPrivate->iCurrentMode);
+}
+
+QUsbMode::ModeId QUsbModed::targetModeId() const
+{
+    return modeId(iPrivate->iTargetMode);
+}
+
+bool QUsbModed::hasConfigValue(const QString &aSect, const QString &aKey) const
+{
+    return iPrivate->iConfig.value(Private::ConfigKey(aSect, aKey)).iValid;
+}
+
+QString QUsbModed::configValue(const QString &aSect, const QString &aKey) const
+{
+    return iPrivate->iConfig.value(Private::ConfigKey(aSect, aKey)).iValue;
+}
+
+void QUsbModed::subscribeConfigValue(QUsbModedConfigValue* aValue)
+{
+    iPrivate->iConfig[Private::ConfigKey(aValue->section(), aValue->key())].
+        iSubscribers.append(aValue);
+}
+
+void QUsbModed::unsubscribeConfigValue(QUsbModedConfigValue* aValue)
+{
+    const Private::ConfigKey key(aValue->section(), aValue->key());
+    auto it = iPrivate->iConfig.find(key);
+    if (it != iPrivate->iConfig.end()) {
+        it->iSubscribers.removeAll(aValue);
+        if (!it->iValid && it->iSubscribers.isEmpty()) {
+            iPrivate->iConfig.erase(it);
+        }
+    }
+}
+
+void QUsbModed::updateConfigValue(const QString &aSect, const QString &aKey,
+    const QString &aVal)
+{
+    // Known keys take a single lookup, new ones get inserted with the
+    // interned copies of the section and key
+    auto it = iPrivate->iConfig.find(Private::ConfigKey(aSect, aKey));
+    if (it == iPrivate->iConfig.end()) {
+        it = iPrivate->iConfig.insert(Private::ConfigKey(internMode(aSect),
+            internMode(aKey)), Private::ConfigEntry());
+    }
+    if (!it->iValid || it->iValue != aVal) {
+        const bool becameValid = !it->iValid;
+        it->iValue = aVal;
+        it->iValid = true;
+        notifyConfigSubscribers(it.key(), becameValid);
+    }
+}
+
+void QUsbModed::notifyConfigSubscribers(const QPair<QString,QString> &aKey,
+    bool aValidityChanged)
+{
+    // Only subscribers of this particular key get notified. Handlers may
+    // delete the subscribers and change the configuration. If this key
+    // gets updated again (or dropped), the newer update has notified
+    // everyone. Updates of other keys don't stop this one.
+    auto it = iPrivate->iConfig.find(aKey);
+    const uint generation = ++iPrivate->iConfigGeneration;
+    it->iGeneration = generation;
+    const Private::ConfigKey key(it.key());
+    const int n = it->iSubscribers.count();
+    QList<QPointer<QUsbModedConfigValue> > subscribers;
+    subscribers.reserve(n);
+    for (int i=0; i<n; i++) {
+        subscribers.append(it->iSubscribers.at(i));
+    }
+    for (int i=0; i<n; i++) {
+        if (i > 0) {
+            it = iPrivate->iConfig.find(key);
+            if (it == iPrivate->iConfig.end() || it->iGeneration != generation) {
+                break;
+            }
+        }
+        QUsbModedConfigValue* value = subscribers.at(i);
+        if (value) {
+            value->notifyChanged(aValidityChanged);
+        }
+    }
+}
+
+void QUsbModed::invalidateConfigValues()
+{
+    // Whatever usb_moded reported before is no longer known to be true.
+    // Entries nobody is watching are simply dropped.
+    QList<Private::ConfigKey> invalidated;
+    auto it = iPrivate->iConfig.begin();
+    while (it != iPrivate->iConfig.end()) {
+        if (it->iSubscribers.isEmpty()) {
+            it = iPrivate->iConfig.erase(it);
+        } else {
+            if (it->iValid) {
+                it->iValid = false;
+                it->iValue.clear();
+                invalidated.append(it.key());
+            }
+            ++it;
+        }
+    }
+    const int n = invalidated.count();
+    for (int i=0; i<n; i++) {
+        // Handlers of the previous keys may have changed things
+        auto entry = iPrivate->iConfig.constFind(invalidated.at(i));
+        if (entry != iPrivate->iConfig.constEnd() && !entry->iValid) {
+            notifyConfigSubscribers(invalidated.at(i), true);
+        }
+    }
+}
+
+bool QUsbModed::setCurrentMode(const QString &aMode)
+{
+    if (userCallsAllowed()) {
+        iPrivate->scheduleCall(UserCallPriority, [this, aMode]() {
+            return iPrivate->iInterface->set_mode(aMode);
+        }, [this](QDBusPendingCallWatcher* aCall) {
+            onSetModeFinished(aCall);
+        });
+        return true;
+    }
+    return false;
+}
+
+bool QUsbModed::setCurrentMode(ModeId aMode)
 {
-    if (iPrivate->iInterface) {
-        auto *pendingCall = new QDBusPendingCallWatcher(iPrivate->iInterface->set_mode(aMode), this);
+    return aMode != IdUnknown && setCurrentMode(modeName(aMode));
+}
 
-        connect(pendingCall, &QDBusPendingCallWatcher::finished,
-                this, &QUsbModed::onSetModeFinished);
+bool QUsbModed::setConfigMode(const QString &aMode)
+{
+    if (userCallsAllowed()) {
+        iPrivate->scheduleCall(UserCallPriority, [this, aMode]() {
+            return iPrivate->iInterface->set_config(aMode);
+        }, [this](QDBusPendingCallWatcher* aCall) {
+            onSetConfigFinished(aCall);
+        });
         return true;
     }
     return false;
 }
 
-bool QUsbModed::setConfigMode(QString aMode)
+bool QUsbModed::setConfigMode(ModeId aMode)
+{
+    return aMode != IdUnknown && setConfigMode(modeName(aMode));
+}
+
+bool QUsbModed::hideMode(const QString &mode)
 {
-    if (iPrivate->iInterface) {
-        auto *pendingCall = new QDBusPendingCallWatcher(iPrivate->iInterface->set_config(aMode), this);
-        connect(pendingCall, &QDBusPendingCallWatcher::finished,
-                this, &QUsbModed::onSetConfigFinished);
+    if (userCallsAllowed()) {
+        iPrivate->scheduleCall(UserCallPriority, [this, mode]() {
+            return iPrivate->iInterface->hide_mode(mode);
+        }, [this](QDBusPendingCallWatcher* aCall) {
+            onHideModeFinished(aCall);
+        });
         return true;
     }
     return false;
 }
 
-bool QUsbModed::hideMode(QString mode)
+bool QUsbModed::unhideMode(const QString &mode)
 {
-    if (iPrivate->iInterface) {
-        auto *pendingCall = new QDBusPendingCallWatcher(iPrivate->iInterface->hide_mode(mode), this);
-        connect(pendingCall, &QDBusPendingCallWatcher::finished,
-                this, &QUsbModed::onHideModeFinished);
+    if (userCallsAllowed()) {
+        iPrivate->scheduleCall(UserCallPriority, [this, mode]() {
+            return iPrivate->iInterface->unhide_mode(mode);
+        }, [this](QDBusPendingCallWatcher* aCall) {
+            onUnhideModeFinished(aCall);
+        });
         return true;
     }
     return false;
 }
 
-bool QUsbModed::unhideMode(QString mode)
+bool QUsbModed::hideModes(const QStringList &aModes)
+{
+    return startModeBatch(aModes, true);
+}
+
+bool QUsbModed::unhideModes(const QStringList &aModes)
+{
+    return startModeBatch(aModes, false);
+}
+
+bool QUsbModed::startModeBatch(const QStringList &aModes, bool aHide)
+{
+    if (userCallsAllowed()) {
+        QSharedPointer<Private::ModeBatch> batch(new Private::ModeBatch(aHide));
+        const int n = aModes.count();
+        iPrivate->iModeBatches++;
+        for (int i=0; i<n; i++) {
+            const QString mode(aModes.at(i));
+            batch->iPending++;
+            iPrivate->scheduleCall(UserCallPriority, [this, aHide, mode]() {
+                    return aHide ?
+                        iPrivate->iInterface->hide_mode(mode) :
+                        iPrivate->iInterface->unhide_mode(mode);
+                }, [this, batch, mode](QDBusPendingCallWatcher* aCall) {
+                    QDBusPendingReply<QString> reply(*aCall);
+                    if (reply.isError()) {
+                        qCDebug(lcQusb) << mode << reply.error();
+                        batch->iFailed.append(mode);
+                    }
+                    aCall->deleteLater();
+                    if (!--batch->iPending) {
+                        modeBatchFinished();
+                        if (batch->iHide) {
+                            Q_EMIT hideModesFinished(batch->iFailed);
+                        } else {
+                            Q_EMIT unhideModesFinished(batch->iFailed);
+                        }
+                    }
+                });
+        }
+        if (!n) {
+            modeBatchFinished();
+            if (aHide) {
+                Q_EMIT hideModesFinished(QStringList());
+            } else {
+                Q_EMIT unhideModesFinished(QStringList());
+            }
+        }
+        return true;
+    }
+    return false;
+}
+
+void QUsbModed::modeBatchFinished()
+{
+    Q_ASSERT(iPrivate->iModeBatches > 0);
+    if (!--iPrivate->iModeBatches && iPrivate->iHiddenModesChangePending) {
+        iPrivate->iHiddenModesChangePending = false;
+        Q_EMIT hiddenModesChanged();
+    }
+}
+
+bool QUsbModed::switchMode(const QString &aMode, int aTimeoutMs)
 {
-    if (iPrivate->iInterface) {
-        auto *pendingCall = new QDBusPendingCallWatcher(iPrivate->iInterface->unhide_mode(mode), this);
-        connect(pendingCall, &QDBusPendingCallWatcher::finished,
-                this, &QUsbModed::onUnhideModeFinished);
+    if (userCallsAllowed()) {
+        if (iPrivate->iSwitchPending) {
+            finishModeSwitch(ModeSwitchCanceled);
+        }
+
+        if (!iPrivate->iSwitchTimer) {
+            iPrivate->iSwitchTimer = iPrivate->iClock->createTimer(this);
+            connect(iPrivate->iSwitchTimer, &QUsbModedTimer::timeout,
+                    this, &QUsbModed::onModeSwitchTimeout);
+        }
+
+        iPrivate->iSwitchMode = aMode;
+        iPrivate->iSwitchPending = true;
+        iPrivate->iSwitchTimer->start(aTimeoutMs);
+        const uint serial = ++iPrivate->iSwitchSerial;
+        iPrivate->scheduleCall(UserCallPriority, [this, aMode]() {
+            return iPrivate->iInterface->set_mode(aMode);
+        }, [this, serial](QDBusPendingCallWatcher* aCall) {
+            switchModeFinished(aCall, serial);
+        });
         return true;
     }
     return false;
 }
 
-void QUsbModed::onServiceRegistered(QString aService)
+bool QUsbModed::switchMode(ModeId aMode, int aTimeoutMs)
+{
+    return aMode != IdUnknown && switchMode(modeName(aMode), aTimeoutMs);
+}
+
+bool QUsbModed::modeSwitchPending() const
+{
+    return iPrivate->iSwitchPending;
+}
+
+bool QUsbModed::debouncedConnected() const
+{
+    return iPrivate->iDebouncedConnected;
+}
+
+int QUsbModed::suppressedFlaps() const
+{
+    return iPrivate->iSuppressedFlaps;
+}
+
+int QUsbModed::connectSettleTime() const
+{
+    return iPrivate->iConnectSettleTime;
+}
+
+int QUsbModed::disconnectSettleTime() const
+{
+    return iPrivate->iDisconnectSettleTime;
+}
+
+void QUsbModed::setSettleTimes(int aConnectMs, int aDisconnectMs)
+{
+    iPrivate->iConnectSettleTime = qMax(aConnectMs, 0);
+    iPrivate->iDisconnectSettleTime = qMax(aDisconnectMs, 0);
+    if (!iPrivate->iSettleTimer) {
+        iPrivate->iSettleTimer = iPrivate->iClock->createTimer(this);
+        connect(iPrivate->iSettleTimer, &QUsbModedTimer::timeout,
+                this, &QUsbModed::onSettleTimeout);
+    } else if (iPrivate->iSettleTimer->isActive()) {
+        // Let the pending transition wait for the new settle time
+        iPrivate->iSettleTimer->start(iPrivate->iCableConnected ?
+            iPrivate->iConnectSettleTime : iPrivate->iDisconnectSettleTime);
+    }
+}
+
+void QUsbModed::updateCableState(const QString &aMode)
+{
+    bool connected;
+    if (isEvent(aMode)) {
+        // Only cable events, not e.g. data_in_use or pre-unmount
+        if (aMode == Mode::Connected || aMode == Mode::ChargerConnected) {
+            connected = true;
+        } else if (aMode == Mode::Disconnected ||
+                   aMode == Mode::ChargerDisconnected) {
+            connected = false;
+        } else {
+            return;
+        }
+    } else if (isDisconnected(aMode)) {
+        connected = false;
+    } else if (isConnected(aMode)) {
+        connected = true;
+    } else {
+        // Busy is neither
+        return;
+    }
+
+    if (iPrivate->iCableConnected != connected) {
+        iPrivate->iCableConnected = connected;
+        const int settleTime = connected ?
+            iPrivate->iConnectSettleTime :
+            iPrivate->iDisconnectSettleTime;
+        if (connected == iPrivate->iDebouncedConnected) {
+            if (iPrivate->iSettleTimer && iPrivate->iSettleTimer->isActive()) {
+                // Flipped back before settling
+                iPrivate->iSettleTimer->stop();
+                iPrivate->iSuppressedFlaps++;
+                qCDebug(lcQusb) << "suppressed flap" << iPrivate->iSuppressedFlaps;
+                Q_EMIT suppressedFlapsChanged();
+            }
+        } else if (settleTime > 0 && iPrivate->iSettleTimer) {
+            iPrivate->iSettleTimer->start(settleTime);
+        } else {
+            setDebouncedConnected(connected);
+        }
+    }
+}
+
+void QUsbModed::onSettleTimeout()
+{
+    setDebouncedConnected(iPrivate->iCableConnected);
+}
+
+void QUsbModed::setDebouncedConnected(bool aConnected)
+{
+    if (iPrivate->iDebouncedConnected != aConnected) {
+        qCDebug(lcQusb) << aConnected;
+        iPrivate->iDebouncedConnected = aConnected;
+        iPrivate->propertyChanged(DebouncedConnectedProperty);
+        Q_EMIT debouncedConnectedChanged();
+    }
+}
+
+QUsbModed::Health QUsbModed::health() const
+{
+    return iPrivate->iHealth;
+}
+
+int QUsbModed::probeLatency() const
+{
+    return iPrivate->iProbeLatency;
+}
+
+bool QUsbModed::watchdogEnabled() const
+{
+    return iPrivate->iWatchdogTimer != nullptr;
+}
+
+void QUsbModed::setWatchdogEnabled(bool aEnabled)
+{
+    if (aEnabled && !iPrivate->iWatchdogTimer) {
+        iPrivate->iWatchdogTimer = iPrivate->iClock->createTimer(this);
+        connect(iPrivate->iWatchdogTimer, &QUsbModedTimer::timeout,
+                this, &QUsbModed::onWatchdogTimeout);
+        watchdogActivity();
+    } else if (!aEnabled && iPrivate->iWatchdogTimer) {
+        delete iPrivate->iWatchdogTimer;
+        iPrivate->iWatchdogTimer = nullptr;
+        iPrivate->iProbeCall = nullptr;
+        setHealth(HealthUnknown);
+    }
+}
+
+int QUsbModed::maxPendingCalls() const
+{
+    return iPrivate->iMaxPendingCalls;
+}
+
+void QUsbModed::setMaxPendingCalls(int aCount)
+{
+    iPrivate->iMaxPendingCalls = qMax(aCount, 1);
+    iPrivate->dispatchCalls();
+}
+
+int QUsbModed::schedulingDelay(CallPriority aPriority) const
+{
+    return (aPriority >= 0 && aPriority < CallPriorityCount) ?
+        iPrivate->iSchedulingDelay[aPriority] : 0;
+}
+
+int QUsbModed::maxSchedulingDelay(CallPriority aPriority) const
+{
+    return (aPriority >= 0 && aPriority < CallPriorityCount) ?
+        iPrivate->iMaxSchedulingDelay[aPriority] : 0;
+}
+
+QUsbModedClock* QUsbModed::clock() const
+{
+    return iPrivate->iClock;
+}
+
+void QUsbModed::setClock(QUsbModedClock* aClock)
+{
+    // Existing timers stay with the clock they were created by
+    iPrivate->iClock = aClock ? aClock : QUsbModedClock::system();
+}
+
+bool QUsbModed::userCallsAllowed() const
+{
+    // Don't queue requests behind a stalled daemon
+    return iPrivate->iInterface && iPrivate->iHealth != Stalled;
+}
+
+void QUsbModed::userCallStarted(QDBusPendingCallWatcher* aCall)
+{
+    iPrivate->iUserCalls++;
+    connect(aCall, &QDBusPendingCallWatcher::finished, this, [this]() {
+        iPrivate->iUserCalls--;
+    });
+    watchdogActivity();
+}
+
+bool QUsbModed::watchdogNeeded() const
+{
+    // Only probe while waiting for usb_moded to do something, so that
+    // an idle device doesn't get woken up
+    return iPrivate->iInterface && (iPrivate->iUserCalls > 0 ||
+        iPrivate->iSwitchPending || iPrivate->iHealth == Stalled ||
+        iPrivate->iCurrentMode == Mode::Busy);
+}
+
+void QUsbModed::watchdogActivity()
+{
+    iPrivate->iProbeInterval = Private::WatchdogMinInterval;
+    if (iPrivate->iWatchdogTimer && !iPrivate->iProbeCall &&
+        watchdogNeeded()) {
+        iPrivate->iWatchdogTimer->start(iPrivate->iProbeInterval);
+    }
+}
+
+void QUsbModed::onWatchdogTimeout()
+{
+    if (iPrivate->iProbeCall) {
+        // No reply within WatchdogStallTimeout
+        qCWarning(lcQusb) << "usb_moded is not responding";
+        setHealth(Stalled);
+    } else if (watchdogNeeded()) {
+        iPrivate->iProbeCall = new QDBusPendingCallWatcher(iPrivate->iInterface->mode_request(), this);
+        connect(iPrivate->iProbeCall, &QDBusPendingCallWatcher::finished,
+                this, &QUsbModed::onProbeFinished);
+        iPrivate->iProbeTime = iPrivate->iClock->now();
+        iPrivate->iWatchdogTimer->start(Private::WatchdogStallTimeout);
+    }
+}
+
+void QUsbModed::onProbeFinished(QDBusPendingCallWatcher* aCall)
+{
+    QDBusPendingReply<QString> reply(*aCall);
+    if (aCall == iPrivate->iProbeCall) {
+        iPrivate->iProbeCall = nullptr;
+        iPrivate->iWatchdogTimer->stop();
+        if (!reply.isError()) {
+            iPrivate->iProbeLatency = int(iPrivate->iClock->now() - iPrivate->iProbeTime);
+            qCDebug(lcQusb) << "probe latency" << iPrivate->iProbeLatency;
+            setHealth((iPrivate->iProbeLatency > Private::WatchdogDegradedLatency) ?
+                Degraded : Healthy);
+        } else {
+            qCDebug(lcQusb) << reply.error();
+            if (reply.error().type() == QDBusError::NoReply ||
+                reply.error().type() == QDBusError::Timeout) {
+                setHealth(Stalled);
+            }
+        }
+        if (watchdogNeeded()) {
+            // Back off while things keep going well
+            iPrivate->iWatchdogTimer->start(iPrivate->iProbeInterval);
+            if (iPrivate->iHealth == Healthy) {
+                iPrivate->iProbeInterval = qMin(iPrivate->iProbeInterval * 2,
+                    int(Private::WatchdogMaxInterval));
+            }
+        }
+    }
+    aCall->deleteLater();
+}
+
+void QUsbModed::setHealth(Health aHealth)
+{
+    if (iPrivate->iHealth != aHealth) {
+        qCDebug(lcQusb) << aHealth;
+        iPrivate->iHealth = aHealth;
+        Q_EMIT healthChanged();
+        if (aHealth == Stalled && iPrivate->iSwitchPending) {
+            finishModeSwitch(ModeSwitchFailed);
+        }
+    }
+}
+
+void QUsbModed::onServiceRegistered(const QString &aService)
 {
     qCDebug(lcQusb) << aService;
     setup();
 }
 
-void QUsbModed::onServiceUnregistered(QString aService)
+void QUsbModed::onServiceUnregistered(const QString &aService)
 {
     qCDebug(lcQusb) << aService;
     iPrivate->iPendingCalls = 0;
 
-    delete iPrivate->iInterface;
+    if (iPrivate->iSwitchPending) {
+        finishModeSwitch(ModeSwitchFailed);
+    }
+
+    iPrivate->iProbeCall = nullptr;
+    if (iPrivate->iWatchdogTimer) {
+        iPrivate->iWatchdogTimer->stop();
+    }
+    setHealth(HealthUnknown);
+
+    iPrivate->dropQueuedCalls();
     iPrivate->iInterface = nullptr;
+    invalidateConfigValues();
 
     if (iPrivate->iAvailable) {
         iPrivate->iAvailable = false;
+        iPrivate->propertyChanged(AvailableProperty);
         Q_EMIT availableChanged();
     }
 }
 
 void QUsbModed::setup()
 {
-    delete iPrivate->iInterface; // That cancels whatever is in progress
+    iPrivate->iInterface = iPrivate->iConnection->iInterface;
 
-    iPrivate->iInterface = new QUsbModedInterface(USB_MODE_SERVICE,
-        USB_MODE_OBJECT, QDBusConnection::systemBus(), this);
+    // Request the current state. The current mode goes first, the rest
+    // may wait for a free slot (and for user initiated calls).
+    iPrivate->dropQueuedCalls();
 
-    connect(iPrivate->iInterface,
-        SIGNAL(sig_usb_target_state_ind(QString)),
-        SLOT(onUsbTargetStateChanged(QString)));
-    connect(iPrivate->iInterface,
-        SIGNAL(sig_usb_current_state_ind(QString)),
-        SLOT(onUsbStateChanged(QString)));
-    connect(iPrivate->iInterface,
-        SIGNAL(sig_usb_event_ind(QString)),
-        SLOT(onUsbEventReceived(QString)));
-    connect(iPrivate->iInterface,
-        SIGNAL(sig_usb_config_ind(QString,QString,QString)),
-        SLOT(onUsbConfigChanged(QString,QString,QString)));
-    connect(iPrivate->iInterface,
-        SIGNAL(sig_usb_supported_modes_ind(QString)),
-        SLOT(onUsbSupportedModesChanged(QString)));
-    connect(iPrivate->iInterface,
-            &QUsbModedInterface::sig_usb_available_modes_ind,
-            this,
-            &QUsbModed::checkAvailableModesForUser);
-    connect(iPrivate->iInterface,
-        SIGNAL(sig_usb_hidden_modes_ind(QString)),
-        SLOT(onUsbHiddenModesChanged(QString)));
-    connect(iPrivate->iInterface,
-        SIGNAL(sig_usb_state_error_ind(QString)),
-        SIGNAL(usbStateError(QString)));
+    iPrivate->iPendingCalls |= USB_MODED_CALL_MODE_REQUEST;
+    iPrivate->scheduleCall(BackgroundCallPriority, [this]() {
+        return iPrivate->iInterface->mode_request();
+    }, [this](QDBusPendingCallWatcher* aCall) {
+        onGetModeRequestFinished(aCall);
+    });
+
+    iPrivate->iPendingCalls |= USB_MODED_CALL_GET_TARGET_MODE;
+    iPrivate->scheduleCall(BackgroundCallPriority, [this]() {
+        return iPrivate->iInterface->get_target_state();
+    }, [this](QDBusPendingCallWatcher* aCall) {
+        onGetTargetModeFinished(aCall);
+    });
 
-    // Request the current state
     iPrivate->iPendingCalls |= USB_MODED_CALL_GET_MODES;
-    auto *pendingCall = new QDBusPendingCallWatcher(iPrivate->iInterface->get_modes(), this);
-    connect(pendingCall, &QDBusPendingCallWatcher::finished,
-            this, &QUsbModed::onGetModesFinished);
+    iPrivate->scheduleCall(BackgroundCallPriority, [this]() {
+        return iPrivate->iInterface->get_modes();
+    }, [this](QDBusPendingCallWatcher* aCall) {
+        onGetModesFinished(aCall);
+    });
 
     iPrivate->iPendingCalls |= USB_MODED_CALL_GET_AVAILABLE_MODES;
-    pendingCall = new QDBusPendingCallWatcher(iPrivate->iInterface->get_available_modes_for_user(), this);
-    connect(pendingCall, &QDBusPendingCallWatcher::finished,
-            this, &QUsbModed::onGetAvailableModesFinished);
+    iPrivate->scheduleCall(BackgroundCallPriority, [this]() {
+        return iPrivate->iInterface->get_available_modes_for_user();
+    }, [this](QDBusPendingCallWatcher* aCall) {
+        onGetAvailableModesFinished(aCall);
+    });
 
     iPrivate->iPendingCalls |= USB_MODED_CALL_GET_CONFIG;
-    pendingCall = new QDBusPendingCallWatcher(iPrivate->iInterface->get_config(), this);
-    connect(pendingCall, &QDBusPendingCallWatcher::finished,
-            this, &QUsbModed::onGetConfigFinished);
-
-    iPrivate->iPendingCalls |= USB_MODED_CALL_GET_TARGET_MODE;
-    pendingCall = new QDBusPendingCallWatcher(iPrivate->iInterface->get_target_state(), this);
-    connect(pendingCall, &QDBusPendingCallWatcher::finished,
-            this, &QUsbModed::onGetTargetModeFinished);
-
-    iPrivate->iPendingCalls |= USB_MODED_CALL_MODE_REQUEST;
-    pendingCall = new QDBusPendingCallWatcher(iPrivate->iInterface->mode_request(), this);
-    connect(pendingCall, &QDBusPendingCallWatcher::finished,
-            this, &QUsbModed::onGetModeRequestFinished);
+    iPrivate->scheduleCall(BackgroundCallPriority, [this]() {
+        return iPrivate->iInterface->get_config();
+    }, [this](QDBusPendingCallWatcher* aCall) {
+        onGetConfigFinished(aCall);
+    });
 
     iPrivate->iPendingCalls |= USB_MODED_CALL_GET_HIDDEN;
-    pendingCall = new QDBusPendingCallWatcher(iPrivate->iInterface->get_hidden(), this);
-    connect(pendingCall, &QDBusPendingCallWatcher::finished,
-            this, &QUsbModed::onGetHiddenFinished);
+    iPrivate->scheduleCall(BackgroundCallPriority, [this]() {
+        return iPrivate->iInterface->get_hidden();
+    }, [this](QDBusPendingCallWatcher* aCall) {
+        onGetHiddenFinished(aCall);
+    });
 }
 
 void QUsbModed::onGetModesFinished(QDBusPendingCallWatcher* aCall)
@@ -298,8 +1146,10 @@ void QUsbModed::onGetConfigFinished(QDBusPendingCallWatcher* aCall)
     if (!reply.isError()) {
         QString mode = reply.value();
         qCDebug(lcQusb) << mode;
+        updateConfigValue(Private::UsbModeSection, Private::UsbModeKeyMode, mode);
         if (iPrivate->iConfigMode != mode) {
-            iPrivate->iConfigMode = mode;
+            iPrivate->iConfigMode = internMode(mode);
+            iPrivate->propertyChanged(ConfigModeProperty);
             Q_EMIT configModeChanged();
         }
     } else {
@@ -316,9 +1166,11 @@ void QUsbModed::onGetModeRequestFinished(QDBusPendingCallWatcher* aCall)
         QString mode = reply.value();
         qCDebug(lcQusb) << mode;
         if (iPrivate->iCurrentMode != mode) {
-            iPrivate->iCurrentMode = mode;
+            iPrivate->iCurrentMode = internMode(mode);
+            iPrivate->propertyChanged(CurrentModeProperty);
             Q_EMIT currentModeChanged();
         }
+        updateCableState(mode);
     } else {
         qCDebug(lcQusb) << reply.error();
     }
@@ -333,7 +1185,8 @@ void QUsbModed::onGetTargetModeFinished(QDBusPendingCallWatcher* aCall)
         QString mode = reply.value();
         qCDebug(lcQusb) << mode;
         if (iPrivate->iTargetMode != mode) {
-            iPrivate->iTargetMode = mode;
+            iPrivate->iTargetMode = internMode(mode);
+            iPrivate->propertyChanged(TargetModeProperty);
             Q_EMIT targetModeChanged();
         }
     } else {
@@ -358,70 +1211,56 @@ void QUsbModed::onGetHiddenFinished(QDBusPendingCallWatcher* aCall)
     setupCallFinished(USB_MODED_CALL_GET_HIDDEN);
 }
 
-void QUsbModed::updateHiddenModes(QString aModes)
+void QUsbModed::updateHiddenModes(const QString &aModes)
 {
-#if QT_VERSION < QT_VERSION_CHECK(5, 14, 0)
-    const QStringList result = aModes.split(',', QString::SkipEmptyParts);
-#else
-    const QStringList result = aModes.split(',', Qt::SkipEmptyParts);
-#endif
-    const int n = result.count();
-    QStringList modes;
-    for (int i=0; i<n; i++) {
-        QString mode(result.at(i).trimmed());
-        if (!modes.contains(mode)) modes.append(mode);
-    }
+    const QStringList modes(Private::parseModes(aModes));
     if (iPrivate->iHiddenModes != modes) {
-        iPrivate->iHiddenModes = modes;
-        Q_EMIT hiddenModesChanged();
+        iPrivate->iHiddenModes = Private::internModes(modes);
+        iPrivate->propertyChanged(HiddenModesProperty);
+        if (iPrivate->iModeBatches) {
+            // Emitted when the last batched call completes
+            iPrivate->iHiddenModesChangePending = true;
+        } else {
+            Q_EMIT hiddenModesChanged();
+        }
     }
 }
 
-void QUsbModed::updateSupportedModes(QString aModes)
+void QUsbModed::updateSupportedModes(const QString &aModes)
 {
-#if QT_VERSION < QT_VERSION_CHECK(5, 14, 0)
-    const QStringList result = aModes.split(',', QString::SkipEmptyParts);
-#else
-    const QStringList result = aModes.split(',', Qt::SkipEmptyParts);
-#endif
-    const int n = result.count();
-    QStringList modes;
-    for (int i=0; i<n; i++) {
-        QString mode(result.at(i).trimmed());
-        if (!modes.contains(mode)) modes.append(mode);
-    }
+    const QStringList modes(Private::parseModes(aModes));
     if (iPrivate->iSupportedModes != modes) {
-        iPrivate->iSupportedModes = modes;
+        iPrivate->iSupportedModes = Private::internModes(modes);
+        iPrivate->propertyChanged(SupportedModesProperty);
         Q_EMIT supportedModesChanged();
     }
 }
 
 void QUsbModed::updateAvailableModes(const QString &aModes)
 {
-#if QT_VERSION < QT_VERSION_CHECK(5, 14, 0)
-    const QStringList result = aModes.split(',', QString::SkipEmptyParts);
-#else
-    const QStringList result = aModes.split(',', Qt::SkipEmptyParts);
-#endif
-    const int n = result.count();
-    QStringList modes;
-    for (int i=0; i<n; i++) {
-        QString mode(result.at(i).trimmed());
-        if (!modes.contains(mode)) modes.append(mode);
-    }
+    const QStringList modes(Private::parseModes(aModes));
     if (iPrivate->iAvailableModes != modes) {
-        iPrivate->iAvailableModes = modes;
+        iPrivate->iAvailableModes = Private::internModes(modes);
+        iPrivate->propertyChanged(AvailableModesProperty);
         Q_EMIT availableModesChanged();
     }
 }
 
 void QUsbModed::checkAvailableModesForUser()
 {
-    connect(new QDBusPendingCallWatcher(
-        iPrivate->iInterface->get_available_modes_for_user(), iPrivate->iInterface),
-        &QDBusPendingCallWatcher::finished,
-        this,
-        &QUsbModed::onGetAvailableModesFinished);
+    // Not a setup call, must not go through setupCallFinished()
+    iPrivate->scheduleCall(BackgroundCallPriority, [this]() {
+        return iPrivate->iInterface->get_available_modes_for_user();
+    }, [this](QDBusPendingCallWatcher* aCall) {
+        QDBusPendingReply<QString> reply(*aCall);
+        if (!reply.isError()) {
+            qCDebug(lcQusb) << reply.value();
+            updateAvailableModes(reply.value());
+        } else {
+            qCDebug(lcQusb) << reply.error();
+        }
+        aCall->deleteLater();
+    });
 }
 
 void QUsbModed::setupCallFinished(int aCallId)
@@ -434,6 +1273,7 @@ void QUsbModed::setupCallFinished(int aCallId)
         qCDebug(lcQusb) << "setup done";
         Q_ASSERT(!iPrivate->iAvailable);
         iPrivate->iAvailable = true;
+        iPrivate->propertyChanged(AvailableProperty);
         Q_EMIT availableChanged();
     }
 }
@@ -454,14 +1294,68 @@ void QUsbModed::onSetModeFinished(QDBusPendingCallWatcher* aCall)
     aCall->deleteLater();
 }
 
+void QUsbModed::switchModeFinished(QDBusPendingCallWatcher* aCall, uint aSerial)
+{
+    QDBusPendingReply<QString> reply(*aCall);
+    if (iPrivate->iSwitchPending && aSerial == iPrivate->iSwitchSerial) {
+        if (!reply.isError()) {
+            qCDebug(lcQusb) << reply.value();
+            // The state may have settled before the reply arrived
+            if (iPrivate->iCurrentMode == iPrivate->iSwitchMode &&
+                isFinalState(iPrivate->iCurrentMode)) {
+                finishModeSwitch(ModeSwitchSucceeded);
+            }
+        } else {
+            qCDebug(lcQusb) << reply.error();
+            finishModeSwitch(ModeSwitchFailed);
+        }
+    }
+    aCall->deleteLater();
+}
+
+void QUsbModed::onModeSwitchTimeout()
+{
+    qCDebug(lcQusb) << iPrivate->iSwitchMode;
+    if (iPrivate->iSwitchPending) {
+        finishModeSwitch(ModeSwitchTimedOut);
+    }
+}
+
+void QUsbModed::checkModeSwitch(const QString &aMode)
+{
+    if (iPrivate->iSwitchPending) {
+        if (aMode == Mode::ModeSettingFailed) {
+            finishModeSwitch(ModeSwitchFailed);
+        } else if (isFinalState(aMode)) {
+            finishModeSwitch((aMode == iPrivate->iSwitchMode) ?
+                ModeSwitchSucceeded : ModeSwitchFallback);
+        }
+    }
+}
+
+void QUsbModed::finishModeSwitch(ModeSwitchResult aResult)
+{
+    // Reset the state first, the signal handler may start another switch
+    const QString mode(iPrivate->iSwitchMode);
+    qCDebug(lcQusb) << mode << aResult;
+    iPrivate->iSwitchMode.clear();
+    iPrivate->iSwitchPending = false;
+    if (iPrivate->iSwitchTimer) {
+        iPrivate->iSwitchTimer->stop();
+    }
+    Q_EMIT modeSwitchFinished(mode, aResult);
+}
+
 void QUsbModed::onSetConfigFinished(QDBusPendingCallWatcher* aCall)
 {
     QDBusPendingReply<QString> reply(*aCall);
     if (!reply.isError()) {
         QString mode = reply.value();
         qCDebug(lcQusb) << mode;
+        updateConfigValue(Private::UsbModeSection, Private::UsbModeKeyMode, mode);
         if (iPrivate->iConfigMode != mode) {
-            iPrivate->iConfigMode = mode;
+            iPrivate->iConfigMode = internMode(mode);
+            iPrivate->propertyChanged(ConfigModeProperty);
             Q_EMIT configModeChanged();
         }
     } else {
@@ -490,49 +1384,61 @@ void QUsbModed::onUnhideModeFinished(QDBusPendingCallWatcher* aCall)
     aCall->deleteLater();
 }
 
-void QUsbModed::onUsbStateChanged(QString aMode)
+void QUsbModed::onUsbStateChanged(const QString &aMode)
 {
     qCDebug(lcQusb) << aMode;
     if (iPrivate->iCurrentMode != aMode) {
-        iPrivate->iCurrentMode = aMode;
+        iPrivate->iCurrentMode = internMode(aMode);
+        iPrivate->propertyChanged(CurrentModeProperty);
         Q_EMIT currentModeChanged();
+        checkModeSwitch(aMode);
+        if (aMode == Mode::Busy) {
+            watchdogActivity();
+        }
     }
+    updateCableState(aMode);
 }
 
-void QUsbModed::onUsbEventReceived(QString aEvent)
+void QUsbModed::onUsbEventReceived(const QString &aEvent)
 {
     qCDebug(lcQusb) << aEvent;
     Q_EMIT eventReceived(aEvent);
+    checkModeSwitch(aEvent);
+    updateCableState(aEvent);
 }
 
-void QUsbModed::onUsbTargetStateChanged(QString aMode)
+void QUsbModed::onUsbTargetStateChanged(const QString &aMode)
 {
     qCDebug(lcQusb) << aMode;
     if (iPrivate->iTargetMode != aMode) {
-        iPrivate->iTargetMode = aMode;
+        iPrivate->iTargetMode = internMode(aMode);
+        iPrivate->propertyChanged(TargetModeProperty);
         Q_EMIT targetModeChanged();
     }
 }
 
-void QUsbModed::onUsbSupportedModesChanged(QString aModes)
+void QUsbModed::onUsbSupportedModesChanged(const QString &aModes)
 {
     qCDebug(lcQusb) << aModes;
     updateSupportedModes(aModes);
 }
 
-void QUsbModed::onUsbHiddenModesChanged(QString modes)
+void QUsbModed::onUsbHiddenModesChanged(const QString &modes)
 {
     qCDebug(lcQusb) << modes;
     updateHiddenModes(modes);
 }
 
-void QUsbModed::onUsbConfigChanged(QString aSect, QString aKey, QString aVal)
+void QUsbModed::onUsbConfigChanged(const QString &aSect, const QString &aKey,
+    const QString &aVal)
 {
     qCDebug(lcQusb) << aSect << aKey << aVal;
+    updateConfigValue(aSect, aKey, aVal);
     if (aSect == Private::UsbModeSection &&
         aKey == Private::UsbModeKeyMode) {
         if (iPrivate->iConfigMode != aVal) {
-            iPrivate->iConfigMode = aVal;
+            iPrivate->iConfigMode = internMode(aVal);
+            iPrivate->propertyChanged(ConfigModeProperty);
             Q_EMIT configModeChanged();
         }
     }
@@ -36,9 +36,13 @@
 
 #include "qusbmode.h"
 
+#include <QDBusConnection>
+#include <QPair>
 #include <QStringList>
 
 class QDBusPendingCallWatcher;
+class QUsbModedClock;
+class QUsbModedConfigValue;
 
 class QUSBMODED_EXPORT QUsbModed : public QUsbMode
 {
@@ -49,10 +53,55 @@ class QUSBMODED_EXPORT QUsbModed : public QUsbMode
     Q_PROPERTY(QStringList hiddenModes READ hiddenModes NOTIFY hiddenModesChanged)
     Q_PROPERTY(QString currentMode READ currentMode WRITE setCurrentMode NOTIFY currentModeChanged)
     Q_PROPERTY(QString targetMode READ targetMode NOTIFY targetModeChanged)
+    Q_PROPERTY(QUsbMode::ModeId currentModeId READ currentModeId NOTIFY currentModeChanged)
+    Q_PROPERTY(QUsbMode::ModeId targetModeId READ targetModeId NOTIFY targetModeChanged)
     Q_PROPERTY(QString configMode READ configMode WRITE setConfigMode NOTIFY configModeChanged)
+    Q_PROPERTY(bool debouncedConnected READ debouncedConnected NOTIFY debouncedConnectedChanged)
+    Q_PROPERTY(int suppressedFlaps READ suppressedFlaps NOTIFY suppressedFlapsChanged)
+    Q_PROPERTY(Health health READ health NOTIFY healthChanged)
 
 public:
+    enum ModeSwitchResult {
+        ModeSwitchSucceeded,    // Requested mode is now active
+        ModeSwitchFallback,     // Settled in some other final state
+        ModeSwitchFailed,       // Request rejected or mode setting failed
+        ModeSwitchTimedOut,     // No final state within the timeout
+        ModeSwitchCanceled      // Superseded by another request
+    };
+    Q_ENUM(ModeSwitchResult)
+
+    enum Health {
+        HealthUnknown,          // Watchdog disabled or no probe yet
+        Healthy,
+        Degraded,               // Slow to respond
+        Stalled                 // Not responding, requests fail fast
+    };
+    Q_ENUM(Health)
+
+    static const int DefaultModeSwitchTimeout = 30000; // ms
+
+    enum StateProperty {
+        AvailableProperty,
+        SupportedModesProperty,
+        AvailableModesProperty,
+        HiddenModesProperty,
+        CurrentModeProperty,
+        TargetModeProperty,
+        ConfigModeProperty,
+        DebouncedConnectedProperty,
+        StatePropertyCount
+    };
+
+    enum CallPriority {
+        UserCallPriority,       // Mode changes and other user actions
+        BackgroundCallPriority, // State refreshes
+        CallPriorityCount
+    };
+
+    static const int DefaultMaxPendingCalls = 4;
+
     explicit QUsbModed(QObject* parent = NULL);
+    explicit QUsbModed(const QDBusConnection &bus, QObject* parent = NULL);
     ~QUsbModed();
 
     bool available() const;
@@ -61,15 +110,84 @@ public:
     QString currentMode() const;
     QString targetMode() const;
     QString configMode() const;
+    ModeId currentModeId() const;
+    ModeId targetModeId() const;
 
-    bool setCurrentMode(QString mode);
-    bool setConfigMode(QString mode);
+    // Incremented whenever the respective property (or any of them)
+    // changes, so that pollers can cheaply tell whether anything has
+    // changed since they last looked. The counters may wrap around.
+    uint stateVersion() const;
+    uint stateVersion(StateProperty property) const;
+
+    bool setCurrentMode(const QString &mode);
+    bool setCurrentMode(ModeId mode);
+    bool setConfigMode(const QString &mode);
+    bool setConfigMode(ModeId mode);
 
     QStringList hiddenModes() const;
 
+    // Requests the mode and emits modeSwitchFinished() once usb_moded
+    // reports a final state (see QUsbMode::isFinalState) or the timeout
+    // expires. Only one switch can be in progress at a time.
+    bool switchMode(const QString &mode, int timeoutMs = DefaultModeSwitchTimeout);
+    bool switchMode(ModeId mode, int timeoutMs = DefaultModeSwitchTimeout);
+    bool modeSwitchPending() const;
+
+    // Cable state with connect/disconnect flapping filtered out. A new
+    // state has to hold for the respective settle time before it gets
+    // reported. Zero settle time (the default) disables the filtering.
+    bool debouncedConnected() const;
+    int suppressedFlaps() const;
+    int connectSettleTime() const;
+    int disconnectSettleTime() const;
+    void setSettleTimes(int connectMs, int disconnectMs);
+
+    // Optional watchdog that probes usb_moded while there are requests
+    // in progress or usb_moded is busy. New requests are rejected while
+    // the daemon is stalled.
+    bool watchdogEnabled() const;
+    void setWatchdogEnabled(bool enabled);
+    Health health() const;
+    int probeLatency() const; // ms, -1 if unknown
+
+    // User initiated calls are sent immediately, background refreshes
+    // wait until fewer than maxPendingCalls calls are in flight.
+    // Scheduling delays are in milliseconds.
+    int maxPendingCalls() const;
+    void setMaxPendingCalls(int count);
+    int schedulingDelay(CallPriority priority) const;
+    int maxSchedulingDelay(CallPriority priority) const;
+
+    // Time source for the switch timeout, debouncing, the watchdog and
+    // the scheduling delays. Must be set before any of those is used and
+    // must outlive this object. Null selects the system clock.
+    QUsbModedClock* clock() const;
+    void setClock(QUsbModedClock* clock);
+
+    // Last value seen in sig_usb_config_ind (see QUsbModedConfigValue).
+    // The values are forgotten when usb_moded goes away.
+    bool hasConfigValue(const QString &section, const QString &key) const;
+    QString configValue(const QString &section, const QString &key) const;
+
 public Q_SLOTS:
+    bool hideMode(const QString &mode);
+    bool unhideMode(const QString &mode);
+
+    // Batched versions of the above. All calls are issued at once,
+    // hiddenModesChanged is emitted at most once after the last reply
+    // and the result is reported by a single hideModesFinished() or
+    // unhideModesFinished() signal.
+    bool hideModes(const QStringList &modes);
+    bool unhideModes(const QStringList &modes);
+
+#ifdef QUSBMODED_COMPAT_ABI
+    // By-value versions of the 1.x API. These are only compiled into
+    // the library for binary compatibility (see qusbmoded_compat.cpp)
+    bool setCurrentMode(QString mode);
+    bool setConfigMode(QString mode);
     bool hideMode(QString mode);
     bool unhideMode(QString mode);
+#endif
 
 Q_SIGNALS:
     void availableChanged();
@@ -83,10 +201,16 @@ Q_SIGNALS:
     void hiddenModesChanged();
     void hideModeFailed(QString mode);
     void unhideModeFailed(QString mode);
+    void hideModesFinished(QStringList failedModes);
+    void unhideModesFinished(QStringList failedModes);
+    void modeSwitchFinished(QString mode, QUsbModed::ModeSwitchResult result);
+    void debouncedConnectedChanged();
+    void suppressedFlapsChanged();
+    void healthChanged();
 
 private Q_SLOTS:
-    void onServiceRegistered(QString service);
-    void onServiceUnregistered(QString service);
+    void onServiceRegistered(const QString &service);
+    void onServiceUnregistered(const QString &service);
     void onGetModesFinished(QDBusPendingCallWatcher* call);
     void onGetAvailableModesFinished(QDBusPendingCallWatcher *call);
     void onGetConfigFinished(QDBusPendingCallWatcher* call);
@@ -97,20 +221,43 @@ private Q_SLOTS:
     void onHideModeFinished(QDBusPendingCallWatcher* call);
     void onUnhideModeFinished(QDBusPendingCallWatcher* call);
     void onGetHiddenFinished(QDBusPendingCallWatcher* call);
-    void onUsbConfigChanged(QString section, QString key, QString value);
-    void onUsbStateChanged(QString mode);
-    void onUsbEventReceived(QString event);
-    void onUsbTargetStateChanged(QString mode);
-    void onUsbSupportedModesChanged(QString modes);
-    void onUsbHiddenModesChanged(QString modes);
+    void onUsbConfigChanged(const QString &section, const QString &key, const QString &value);
+    void onUsbStateChanged(const QString &mode);
+    void onUsbEventReceived(const QString &event);
+    void onUsbTargetStateChanged(const QString &mode);
+    void onUsbSupportedModesChanged(const QString &modes);
+    void onUsbHiddenModesChanged(const QString &modes);
+    void onModeSwitchTimeout();
+    void onSettleTimeout();
+    void onWatchdogTimeout();
+    void onProbeFinished(QDBusPendingCallWatcher* call);
 
 private:
+    friend class QUsbModedConfigValue;
+    void subscribeConfigValue(QUsbModedConfigValue* value);
+    void unsubscribeConfigValue(QUsbModedConfigValue* value);
+    void updateConfigValue(const QString &section, const QString &key, const QString &value);
+    void notifyConfigSubscribers(const QPair<QString,QString> &key, bool validityChanged);
+    void invalidateConfigValues();
+    void init(const QDBusConnection &bus);
     void setup();
     void setupCallFinished(int callId);
-    void updateSupportedModes(QString modes);
+    void updateSupportedModes(const QString &modes);
     void updateAvailableModes(const QString &modes);
     void checkAvailableModesForUser();
-    void updateHiddenModes(QString modes);
+    void updateHiddenModes(const QString &modes);
+    bool startModeBatch(const QStringList &modes, bool hide);
+    void modeBatchFinished();
+    void switchModeFinished(QDBusPendingCallWatcher* call, uint serial);
+    void checkModeSwitch(const QString &mode);
+    void finishModeSwitch(ModeSwitchResult result);
+    void updateCableState(const QString &mode);
+    void setDebouncedConnected(bool connected);
+    bool userCallsAllowed() const;
+    void userCallStarted(QDBusPendingCallWatcher* call);
+    bool watchdogNeeded() const;
+    void watchdogActivity();
+    void setHealth(Health health);
 
 private:
     class Private;
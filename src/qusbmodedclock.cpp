@@ -0,0 +1,208 @@
+/*
+ * Copyright (C) 2026 Jolla Ltd.
+ *
+ * You may use this file under the terms of the BSD license as follows:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in
+ *     the documentation and/or other materials provided with the
+ *     distribution.
+ *   * Neither the name of Nemo Mobile nor the names of its contributors
+ *     may be used to endorse or promote products derived from this
+ *     software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "qusbmodedclock.h"
+
+#include <QElapsedTimer>
+#include <QList>
+#include <QTimer>
+
+// ==========================================================================
+// QUsbModedTimer
+// ==========================================================================
+
+QUsbModedTimer::QUsbModedTimer(QObject* aParent) :
+    QObject(aParent)
+{
+}
+
+// ==========================================================================
+// QUsbModedClock
+// ==========================================================================
+
+class QUsbModedSystemTimer : public QUsbModedTimer
+{
+public:
+    QUsbModedSystemTimer(QObject* aParent) :
+        QUsbModedTimer(aParent),
+        iTimer(new QTimer(this))
+    {
+        iTimer->setSingleShot(true);
+        connect(iTimer, &QTimer::timeout, this, &QUsbModedTimer::timeout);
+    }
+
+    void start(int aMsec) override { iTimer->start(aMsec); }
+    void stop() override { iTimer->stop(); }
+    bool isActive() const override { return iTimer->isActive(); }
+
+private:
+    QTimer* iTimer;
+};
+
+class QUsbModedSystemClock : public QUsbModedClock
+{
+public:
+    QUsbModedSystemClock() { iElapsed.start(); }
+
+    qint64 now() const override { return iElapsed.elapsed(); }
+    QUsbModedTimer* createTimer(QObject* aParent) override
+        { return new QUsbModedSystemTimer(aParent); }
+
+private:
+    QElapsedTimer iElapsed;
+};
+
+QUsbModedClock::~QUsbModedClock()
+{
+}
+
+QUsbModedClock* QUsbModedClock::system()
+{
+    static QUsbModedSystemClock clock;
+    return &clock;
+}
+
+// ==========================================================================
+// QUsbModedSimulatedClock
+// ==========================================================================
+
+class QUsbModedSimulatedClock::Private
+{
+public:
+    Private() : iNow(0), iSequence(0) {}
+
+    Timer* nextTimer(qint64 aLimit) const;
+
+    qint64 iNow;
+    quint64 iSequence;
+    QList<Timer*> iActive;
+};
+
+class QUsbModedSimulatedClock::Timer : public QUsbModedTimer
+{
+public:
+    Timer(QUsbModedSimulatedClock::Private* aClock, QObject* aParent) :
+        QUsbModedTimer(aParent),
+        iClock(aClock),
+        iDeadline(0),
+        iSequence(0) {}
+
+    ~Timer() { stop(); }
+
+    void start(int aMsec) override
+    {
+        stop();
+        iDeadline = iClock->iNow + qMax(aMsec, 0);
+        iSequence = iClock->iSequence++;
+        iClock->iActive.append(this);
+    }
+
+    void stop() override { iClock->iActive.removeAll(this); }
+    bool isActive() const override { return iClock->iActive.contains(const_cast<Timer*>(this)); }
+
+    void fire()
+    {
+        stop();
+        Q_EMIT timeout();
+    }
+
+    QUsbModedSimulatedClock::Private* iClock;
+    qint64 iDeadline;
+    quint64 iSequence;
+};
+
+QUsbModedSimulatedClock::Timer*
+QUsbModedSimulatedClock::Private::nextTimer(qint64 aLimit) const
+{
+    // Earliest deadline first, timers started earlier win the ties
+    Timer* next = nullptr;
+    const int n = iActive.count();
+    for (int i=0; i<n; i++) {
+        Timer* timer = iActive.at(i);
+        if (timer->iDeadline <= aLimit && (!next ||
+            timer->iDeadline < next->iDeadline ||
+            (timer->iDeadline == next->iDeadline &&
+             timer->iSequence < next->iSequence))) {
+            next = timer;
+        }
+    }
+    return next;
+}
+
+QUsbModedSimulatedClock::QUsbModedSimulatedClock() :
+    iPrivate(new Private)
+{
+}
+
+QUsbModedSimulatedClock::~QUsbModedSimulatedClock()
+{
+    delete iPrivate;
+}
+
+qint64 QUsbModedSimulatedClock::now() const
+{
+    return iPrivate->iNow;
+}
+
+QUsbModedTimer* QUsbModedSimulatedClock::createTimer(QObject* aParent)
+{
+    return new Timer(iPrivate, aParent);
+}
+
+void QUsbModedSimulatedClock::advance(qint64 aMsec)
+{
+    const qint64 target = iPrivate->iNow + qMax(aMsec, Q_INT64_C(0));
+    Timer* timer;
+    // Timeout handlers may start and stop timers, including the ones
+    // that expire within the same step
+    while ((timer = iPrivate->nextTimer(target)) != nullptr) {
+        iPrivate->iNow = timer->iDeadline;
+        timer->fire();
+    }
+    iPrivate->iNow = target;
+}
+
+bool QUsbModedSimulatedClock::runNext()
+{
+    Timer* timer = iPrivate->nextTimer(Q_INT64_C(0x7fffffffffffffff));
+    if (timer) {
+        iPrivate->iNow = timer->iDeadline;
+        timer->fire();
+        return true;
+    }
+    return false;
+}
+
+int QUsbModedSimulatedClock::activeTimerCount() const
+{
+    return iPrivate->iActive.count();
+}
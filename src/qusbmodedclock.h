@@ -0,0 +1,96 @@
+/*
+ * Copyright (C) 2026 Jolla Ltd.
+ *
+ * You may use this file under the terms of the BSD license as follows:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in
+ *     the documentation and/or other materials provided with the
+ *     distribution.
+ *   * Neither the name of Nemo Mobile nor the names of its contributors
+ *     may be used to endorse or promote products derived from this
+ *     software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef QUSBMODEDCLOCK_H
+#define QUSBMODEDCLOCK_H
+
+#include "qusbmoded_types.h"
+
+#include <QObject>
+
+// Single shot timer created by QUsbModedClock
+class QUSBMODED_EXPORT QUsbModedTimer : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit QUsbModedTimer(QObject* parent = nullptr);
+
+    virtual void start(int msec) = 0;
+    virtual void stop() = 0;
+    virtual bool isActive() const = 0;
+
+Q_SIGNALS:
+    void timeout();
+};
+
+// Time source for the timing dependent parts of QUsbModed (mode switch
+// timeout, debouncing, watchdog, scheduling metrics). The clock must
+// outlive the objects using it.
+class QUSBMODED_EXPORT QUsbModedClock
+{
+public:
+    virtual ~QUsbModedClock();
+
+    // Monotonic time in milliseconds
+    virtual qint64 now() const = 0;
+    virtual QUsbModedTimer* createTimer(QObject* parent) = 0;
+
+    // Monotonic time (QElapsedTimer) and QTimer based timers
+    static QUsbModedClock* system();
+};
+
+// Clock that only moves when told to. Timers fire synchronously from
+// advance() and runNext(), in the order of their deadlines.
+class QUSBMODED_EXPORT QUsbModedSimulatedClock : public QUsbModedClock
+{
+public:
+    QUsbModedSimulatedClock();
+    ~QUsbModedSimulatedClock();
+
+    qint64 now() const override;
+    QUsbModedTimer* createTimer(QObject* parent) override;
+
+    // Moves the time forward by msec, firing the timers that expire
+    void advance(qint64 msec);
+    // Jumps to the nearest deadline and fires that timer. Returns false
+    // if there are no active timers.
+    bool runNext();
+    int activeTimerCount() const;
+
+private:
+    class Timer;
+    class Private;
+    Private* iPrivate;
+};
+
+#endif // QUSBMODEDCLOCK_H
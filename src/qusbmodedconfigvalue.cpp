@@ -0,0 +1,98 @@
+/*
+ * Copyright (C) 2026 Jolla Ltd.
+ *
+ * You may use this file under the terms of the BSD license as follows:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in
+ *     the documentation and/or other materials provided with the
+ *     distribution.
+ *   * Neither the name of Nemo Mobile nor the names of its contributors
+ *     may be used to endorse or promote products derived from this
+ *     software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "qusbmodedconfigvalue.h"
+#include "qusbmoded.h"
+
+#include <QPointer>
+
+class QUsbModedConfigValue::Private
+{
+public:
+    QPointer<QUsbModed> iUsbModed;
+    QString iSection;
+    QString iKey;
+
+    Private(QUsbModed* aUsbModed, const QString &aSection, const QString &aKey) :
+        iUsbModed(aUsbModed),
+        iSection(aSection),
+        iKey(aKey) {}
+};
+
+QUsbModedConfigValue::QUsbModedConfigValue(QUsbModed* aUsbModed,
+    const QString &aSection, const QString &aKey, QObject* aParent)
+    : QObject(aParent)
+    , iPrivate(new Private(aUsbModed, aSection, aKey))
+{
+    if (aUsbModed) {
+        aUsbModed->subscribeConfigValue(this);
+    }
+}
+
+QUsbModedConfigValue::~QUsbModedConfigValue()
+{
+    if (iPrivate->iUsbModed) {
+        iPrivate->iUsbModed->unsubscribeConfigValue(this);
+    }
+    delete iPrivate;
+}
+
+QString QUsbModedConfigValue::section() const
+{
+    return iPrivate->iSection;
+}
+
+QString QUsbModedConfigValue::key() const
+{
+    return iPrivate->iKey;
+}
+
+bool QUsbModedConfigValue::valid() const
+{
+    return iPrivate->iUsbModed &&
+        iPrivate->iUsbModed->hasConfigValue(iPrivate->iSection, iPrivate->iKey);
+}
+
+QString QUsbModedConfigValue::value() const
+{
+    return iPrivate->iUsbModed ?
+        iPrivate->iUsbModed->configValue(iPrivate->iSection, iPrivate->iKey) :
+        QString();
+}
+
+void QUsbModedConfigValue::notifyChanged(bool aValidityChanged)
+{
+    Q_EMIT valueChanged();
+    if (aValidityChanged) {
+        Q_EMIT validChanged();
+    }
+}
@@ -0,0 +1,77 @@
+/*
+ * Copyright (C) 2026 Jolla Ltd.
+ *
+ * You may use this file under the terms of the BSD license as follows:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in
+ *     the documentation and/or other materials provided with the
+ *     distribution.
+ *   * Neither the name of Nemo Mobile nor the names of its contributors
+ *     may be used to endorse or promote products derived from this
+ *     software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef QUSBMODEDCONFIGVALUE_H
+#define QUSBMODEDCONFIGVALUE_H
+
+#include "qusbmoded_types.h"
+
+#include <QObject>
+
+class QUsbModed;
+
+// Tracks a single section/key of the usb_moded configuration. The value
+// is filled from sig_usb_config_ind and becomes invalid when usb_moded
+// goes away. Only the subscribers of the key that has changed get
+// notified.
+class QUSBMODED_EXPORT QUsbModedConfigValue : public QObject
+{
+    Q_OBJECT
+    Q_PROPERTY(QString section READ section CONSTANT)
+    Q_PROPERTY(QString key READ key CONSTANT)
+    Q_PROPERTY(bool valid READ valid NOTIFY validChanged)
+    Q_PROPERTY(QString value READ value NOTIFY valueChanged)
+
+public:
+    QUsbModedConfigValue(QUsbModed* usbModed, const QString &section,
+        const QString &key, QObject* parent = nullptr);
+    ~QUsbModedConfigValue();
+
+    QString section() const;
+    QString key() const;
+    bool valid() const;
+    QString value() const;
+
+Q_SIGNALS:
+    void validChanged();
+    void valueChanged();
+
+private:
+    friend class QUsbModed;
+    void notifyChanged(bool validityChanged);
+
+private:
+    class Private;
+    Private* iPrivate;
+};
+
+#endif // QUSBMODEDCONFIGVALUE_H
@@ -0,0 +1,531 @@
+/*
+ * Copyright (C) 2026 Jolla Ltd.
+ *
+ * You may use this file under the terms of the BSD license as follows:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in
+ *     the documentation and/or other materials provided with the
+ *     distribution.
+ *   * Neither the name of Nemo Mobile nor the names of its contributors
+ *     may be used to endorse or promote products derived from this
+ *     software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "qusbmodedpool.h"
+#include "qusbmoded.h"
+#include "qusbmodedclock.h"
+
+#include "usb_moded-dbus.h"
+
+#include <QDBusConnectionInterface>
+#include <QHash>
+#include <QLoggingCategory>
+#include <QMetaProperty>
+#include <QThread>
+
+Q_LOGGING_CATEGORY(lcQusbPool, "qusbmoded.pool", QtWarningMsg)
+
+// ==========================================================================
+// QUsbModedPoolWorker lives in a dispatch thread and owns the QUsbModed
+// instances (and D-Bus connections) assigned to that thread. Each start
+// carries a serial number. It makes the connection name unique and tells
+// the pool which start a signal belongs to, a removed and re-added
+// endpoint may still have its old instance running in another thread.
+// ==========================================================================
+
+class QUsbModedPoolWorker : public QObject
+{
+    Q_OBJECT
+
+public:
+    QUsbModedPoolWorker(const QString &aPrefix) : iPrefix(aPrefix) {}
+    ~QUsbModedPoolWorker();
+
+public Q_SLOTS:
+    void start(const QString &aName, const QString &aAddress, uint aSerial);
+    void stop(const QString &aName);
+    void setCurrentMode(const QString &aName, const QString &aMode);
+
+Q_SIGNALS:
+    void startFinished(QString name, uint serial);
+    void failed(QString name, uint serial, QString error);
+    void availableChanged(QString name, uint serial, bool available);
+    void changed(QString endpoint, QString property, QVariant value);
+
+private Q_SLOTS:
+    void onPropertyChanged();
+    void onEventReceived(const QString &aEvent);
+    void onAvailableChanged();
+
+private:
+    typedef QHash<int,QList<int> > NotifyMap; // signal => properties
+    static const NotifyMap& notifyMap();
+    QString connectionName(const QString &aName, uint aSerial) const;
+
+private:
+    const QString iPrefix;
+    QHash<QUsbModed*,QString> iNames;
+    QHash<QString,QUsbModed*> iInstances;
+    QHash<QString,uint> iSerials;
+};
+
+QUsbModedPoolWorker::~QUsbModedPoolWorker()
+{
+    const QStringList names(iInstances.keys());
+    const int n = names.count();
+    for (int i=0; i<n; i++) {
+        stop(names.at(i));
+    }
+}
+
+const QUsbModedPoolWorker::NotifyMap& QUsbModedPoolWorker::notifyMap()
+{
+    static const NotifyMap map([]() {
+        NotifyMap result;
+        const QMetaObject* mo = &QUsbModed::staticMetaObject;
+        const int n = mo->propertyCount();
+        for (int i=0; i<n; i++) {
+            const QMetaProperty property(mo->property(i));
+            if (property.hasNotifySignal()) {
+                result[property.notifySignalIndex()].append(i);
+            }
+        }
+        return result;
+    }());
+    return map;
+}
+
+QString QUsbModedPoolWorker::connectionName(const QString &aName,
+    uint aSerial) const
+{
+    return iPrefix + aName + QLatin1Char('-') + QString::number(aSerial);
+}
+
+void QUsbModedPoolWorker::start(const QString &aName, const QString &aAddress,
+    uint aSerial)
+{
+    const QString connection(connectionName(aName, aSerial));
+    QDBusConnection bus(QDBusConnection::connectToBus(aAddress, connection));
+    if (!bus.isConnected()) {
+        const QString error(bus.lastError().message());
+        qCDebug(lcQusbPool) << aName << aAddress << error;
+        QDBusConnection::disconnectFromBus(connection);
+        Q_EMIT failed(aName, aSerial, error);
+        return;
+    }
+
+    QUsbModed* usbModed = new QUsbModed(bus, this);
+    iNames.insert(usbModed, aName);
+    iInstances.insert(aName, usbModed);
+    iSerials.insert(aName, aSerial);
+
+    const QMetaObject* mo = &QUsbModed::staticMetaObject;
+    const QMetaMethod slot(staticMetaObject.method(staticMetaObject.
+        indexOfSlot("onPropertyChanged()")));
+    const NotifyMap& map = notifyMap();
+    for (auto it = map.constBegin(); it != map.constEnd(); ++it) {
+        connect(usbModed, mo->method(it.key()), this, slot);
+    }
+    connect(usbModed, &QUsbModed::eventReceived,
+            this, &QUsbModedPoolWorker::onEventReceived);
+    connect(usbModed, &QUsbModed::availableChanged,
+            this, &QUsbModedPoolWorker::onAvailableChanged);
+
+    // If usb_moded isn't there, there's nothing to wait for. Such
+    // endpoint becomes ready when (and if) the service shows up.
+    if (!bus.interface()->isServiceRegistered(USB_MODE_SERVICE)) {
+        Q_EMIT startFinished(aName, aSerial);
+    }
+}
+
+void QUsbModedPoolWorker::stop(const QString &aName)
+{
+    QUsbModed* usbModed = iInstances.take(aName);
+    if (usbModed) {
+        iNames.remove(usbModed);
+        delete usbModed;
+        QDBusConnection::disconnectFromBus(connectionName(aName,
+            iSerials.take(aName)));
+    }
+}
+
+void QUsbModedPoolWorker::setCurrentMode(const QString &aName, const QString &aMode)
+{
+    QUsbModed* usbModed = iInstances.value(aName);
+    if (usbModed) {
+        usbModed->setCurrentMode(aMode);
+    }
+}
+
+void QUsbModedPoolWorker::onPropertyChanged()
+{
+    QUsbModed* usbModed = qobject_cast<QUsbModed*>(sender());
+    if (usbModed && iNames.contains(usbModed)) {
+        const QString name(iNames.value(usbModed));
+        const QList<int> properties(notifyMap().value(senderSignalIndex()));
+        const QMetaObject* mo = &QUsbModed::staticMetaObject;
+        const int n = properties.count();
+        for (int i=0; i<n; i++) {
+            const QMetaProperty property(mo->property(properties.at(i)));
+            Q_EMIT changed(name, QString::fromLatin1(property.name()),
+                property.read(usbModed));
+        }
+    }
+}
+
+void QUsbModedPoolWorker::onEventReceived(const QString &aEvent)
+{
+    QUsbModed* usbModed = qobject_cast<QUsbModed*>(sender());
+    if (usbModed && iNames.contains(usbModed)) {
+        Q_EMIT changed(iNames.value(usbModed), QStringLiteral("event"), aEvent);
+    }
+}
+
+void QUsbModedPoolWorker::onAvailableChanged()
+{
+    QUsbModed* usbModed = qobject_cast<QUsbModed*>(sender());
+    if (usbModed && iNames.contains(usbModed)) {
+        const QString name(iNames.value(usbModed));
+        Q_EMIT availableChanged(name, iSerials.value(name),
+            usbModed->available());
+    }
+}
+
+// ==========================================================================
+// QUsbModedPool::Private
+// ==========================================================================
+
+class QUsbModedPool::Private
+{
+public:
+    class Endpoint {
+    public:
+        Endpoint(const QString &aAddress, int aWorker) :
+            iAddress(aAddress),
+            iWorker(aWorker),
+            iStartSerial(0),
+            iStarted(false),
+            iStarting(false),
+            iReady(false),
+            iStartupTimer(nullptr) {}
+
+        ~Endpoint()
+        {
+            // This may be called by the timeout handler
+            if (iStartupTimer) {
+                iStartupTimer->stop();
+                iStartupTimer->deleteLater();
+            }
+        }
+
+        QString iAddress;
+        int iWorker;
+        uint iStartSerial;
+        bool iStarted;
+        bool iStarting;
+        bool iReady;
+        QUsbModedTimer* iStartupTimer;
+    };
+
+    QList<QThread*> iThreads;
+    QList<QUsbModedPoolWorker*> iWorkers;
+    QHash<QString,Endpoint*> iEndpoints;
+    QStringList iNames;
+    QStringList iQueue;
+    int iStarting;
+    int iReadyCount;
+    int iStartupBatchSize;
+    int iStartupTimeout;
+    int iNextWorker;
+    uint iStartSerial;
+    QUsbModedClock* iClock;
+
+    Private() :
+        iStarting(0),
+        iReadyCount(0),
+        iStartupBatchSize(DefaultStartupBatchSize),
+        iStartupTimeout(DefaultStartupTimeout),
+        iNextWorker(0),
+        iStartSerial(0),
+        iClock(QUsbModedClock::system()) {}
+
+    ~Private() { qDeleteAll(iEndpoints); }
+
+    // Null if the signal came from an earlier start of the endpoint
+    Endpoint* endpoint(const QString &aName, uint aSerial) const
+    {
+        Endpoint* endpoint = iEndpoints.value(aName);
+        return (endpoint && endpoint->iStartSerial == aSerial) ? endpoint : nullptr;
+    }
+
+    // Releases the startup slot, returns false if it wasn't held
+    bool finishStartup(Endpoint* aEndpoint)
+    {
+        if (aEndpoint->iStarting) {
+            aEndpoint->iStarting = false;
+            if (aEndpoint->iStartupTimer) {
+                aEndpoint->iStartupTimer->stop();
+            }
+            iStarting--;
+            return true;
+        }
+        return false;
+    }
+};
+
+// ==========================================================================
+// QUsbModedPool
+// ==========================================================================
+
+QUsbModedPool::QUsbModedPool(int aThreadCount, QObject* aParent)
+    : QObject(aParent)
+    , iPrivate(new Private)
+{
+    const QString prefix(QString::fromLatin1("qusbmodedpool-%1-").
+        arg(quintptr(this), 0, 16));
+    const int n = qMax(aThreadCount, 1);
+    for (int i=0; i<n; i++) {
+        QUsbModedPoolWorker* worker = new QUsbModedPoolWorker(prefix);
+        if (aThreadCount > 0) {
+            QThread* thread = new QThread(this);
+            worker->moveToThread(thread);
+            connect(thread, &QThread::finished,
+                    worker, &QObject::deleteLater);
+            thread->start();
+            iPrivate->iThreads.append(thread);
+        } else {
+            worker->setParent(this);
+        }
+        connect(worker, &QUsbModedPoolWorker::startFinished,
+                this, &QUsbModedPool::onStartFinished);
+        connect(worker, &QUsbModedPoolWorker::failed,
+                this, &QUsbModedPool::onFailed);
+        connect(worker, &QUsbModedPoolWorker::availableChanged,
+                this, &QUsbModedPool::onAvailableChanged);
+        connect(worker, &QUsbModedPoolWorker::changed,
+                this, &QUsbModedPool::changed);
+        iPrivate->iWorkers.append(worker);
+    }
+}
+
+QUsbModedPool::~QUsbModedPool()
+{
+    const int n = iPrivate->iThreads.count();
+    for (int i=0; i<n; i++) {
+        QThread* thread = iPrivate->iThreads.at(i);
+        thread->quit();
+        thread->wait();
+    }
+    delete iPrivate;
+}
+
+int QUsbModedPool::threadCount() const
+{
+    return iPrivate->iThreads.count();
+}
+
+int QUsbModedPool::count() const
+{
+    return iPrivate->iNames.count();
+}
+
+int QUsbModedPool::readyCount() const
+{
+    return iPrivate->iReadyCount;
+}
+
+int QUsbModedPool::startupBatchSize() const
+{
+    return iPrivate->iStartupBatchSize;
+}
+
+void QUsbModedPool::setStartupBatchSize(int aSize)
+{
+    iPrivate->iStartupBatchSize = qMax(aSize, 1);
+    startNext();
+}
+
+int QUsbModedPool::startupTimeout() const
+{
+    return iPrivate->iStartupTimeout;
+}
+
+void QUsbModedPool::setStartupTimeout(int aMs)
+{
+    // Applies to the endpoints started from now on
+    iPrivate->iStartupTimeout = qMax(aMs, 0);
+}
+
+QUsbModedClock* QUsbModedPool::clock() const
+{
+    return iPrivate->iClock;
+}
+
+void QUsbModedPool::setClock(QUsbModedClock* aClock)
+{
+    // Existing timers stay with the clock they were created by
+    iPrivate->iClock = aClock ? aClock : QUsbModedClock::system();
+}
+
+QStringList QUsbModedPool::endpoints() const
+{
+    return iPrivate->iNames;
+}
+
+bool QUsbModedPool::isReady(const QString &aName) const
+{
+    Private::Endpoint* endpoint = iPrivate->iEndpoints.value(aName);
+    return endpoint && endpoint->iReady;
+}
+
+bool QUsbModedPool::setCurrentMode(const QString &aName, const QString &aMode)
+{
+    Private::Endpoint* endpoint = iPrivate->iEndpoints.value(aName);
+    if (endpoint && endpoint->iStarted) {
+        QMetaObject::invokeMethod(iPrivate->iWorkers.at(endpoint->iWorker),
+            "setCurrentMode", Qt::QueuedConnection, Q_ARG(QString, aName),
+            Q_ARG(QString, aMode));
+        return true;
+    }
+    return false;
+}
+
+bool QUsbModedPool::addEndpoint(const QString &aName, const QString &aAddress)
+{
+    if (!iPrivate->iEndpoints.contains(aName)) {
+        const int worker = iPrivate->iNextWorker;
+        iPrivate->iNextWorker = (worker + 1) % iPrivate->iWorkers.count();
+        iPrivate->iEndpoints.insert(aName, new Private::Endpoint(aAddress, worker));
+        iPrivate->iNames.append(aName);
+        iPrivate->iQueue.append(aName);
+        Q_EMIT countChanged();
+        startNext();
+        return true;
+    }
+    return false;
+}
+
+bool QUsbModedPool::removeEndpoint(const QString &aName)
+{
+    Private::Endpoint* endpoint = iPrivate->iEndpoints.take(aName);
+    if (endpoint) {
+        iPrivate->iNames.removeOne(aName);
+        if (!iPrivate->iQueue.removeOne(aName)) {
+            QMetaObject::invokeMethod(iPrivate->iWorkers.at(endpoint->iWorker),
+                "stop", Qt::QueuedConnection, Q_ARG(QString, aName));
+        }
+        const bool wasReady = endpoint->iReady;
+        iPrivate->finishStartup(endpoint);
+        delete endpoint;
+        Q_EMIT countChanged();
+        if (wasReady) {
+            iPrivate->iReadyCount--;
+            Q_EMIT readyCountChanged();
+        }
+        startNext();
+        return true;
+    }
+    return false;
+}
+
+void QUsbModedPool::startNext()
+{
+    while (iPrivate->iStarting < iPrivate->iStartupBatchSize &&
+           !iPrivate->iQueue.isEmpty()) {
+        const QString name(iPrivate->iQueue.takeFirst());
+        Private::Endpoint* endpoint = iPrivate->iEndpoints.value(name);
+        const uint serial = ++iPrivate->iStartSerial;
+        endpoint->iStartSerial = serial;
+        endpoint->iStarted = true;
+        endpoint->iStarting = true;
+        iPrivate->iStarting++;
+        if (iPrivate->iStartupTimeout > 0) {
+            // A registered but unresponsive usb_moded must not hold the
+            // slot forever
+            if (!endpoint->iStartupTimer) {
+                endpoint->iStartupTimer = iPrivate->iClock->createTimer(this);
+                connect(endpoint->iStartupTimer, &QUsbModedTimer::timeout,
+                    this, [this, name]() { startTimeout(name); });
+            }
+            endpoint->iStartupTimer->start(iPrivate->iStartupTimeout);
+        }
+        qCDebug(lcQusbPool) << "starting" << name;
+        QMetaObject::invokeMethod(iPrivate->iWorkers.at(endpoint->iWorker),
+            "start", Qt::QueuedConnection, Q_ARG(QString, name),
+            Q_ARG(QString, endpoint->iAddress), Q_ARG(uint, serial));
+    }
+}
+
+void QUsbModedPool::onStartFinished(const QString &aName, uint aSerial)
+{
+    Private::Endpoint* endpoint = iPrivate->endpoint(aName, aSerial);
+    if (endpoint && iPrivate->finishStartup(endpoint)) {
+        startNext();
+    }
+}
+
+void QUsbModedPool::startTimeout(const QString &aName)
+{
+    // The instance stays, the endpoint may still become ready later
+    Private::Endpoint* endpoint = iPrivate->iEndpoints.value(aName);
+    if (endpoint && iPrivate->finishStartup(endpoint)) {
+        qCWarning(lcQusbPool) << aName << "startup timed out";
+        Q_EMIT endpointFailed(aName, QStringLiteral("Startup timed out"));
+        startNext();
+    }
+}
+
+void QUsbModedPool::onFailed(const QString &aName, uint aSerial,
+    const QString &aError)
+{
+    // There's no instance behind the endpoint anymore. Failures after
+    // the startup timeout have already been reported.
+    Private::Endpoint* endpoint = iPrivate->endpoint(aName, aSerial);
+    if (endpoint) {
+        endpoint->iStarted = false;
+        if (iPrivate->finishStartup(endpoint)) {
+            Q_EMIT endpointFailed(aName, aError);
+            startNext();
+        }
+    }
+}
+
+void QUsbModedPool::onAvailableChanged(const QString &aName, uint aSerial,
+    bool aAvailable)
+{
+    Private::Endpoint* endpoint = iPrivate->endpoint(aName, aSerial);
+    if (endpoint && endpoint->iReady != aAvailable) {
+        endpoint->iReady = aAvailable;
+        if (aAvailable) {
+            iPrivate->iReadyCount++;
+            onStartFinished(aName, aSerial);
+        } else {
+            iPrivate->iReadyCount--;
+        }
+        Q_EMIT readyCountChanged();
+        if (aAvailable) {
+            Q_EMIT endpointReady(aName);
+        }
+    }
+}
+
+#include "qusbmodedpool.moc"
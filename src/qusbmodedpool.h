@@ -0,0 +1,109 @@
+/*
+ * Copyright (C) 2026 Jolla Ltd.
+ *
+ * You may use this file under the terms of the BSD license as follows:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in
+ *     the documentation and/or other materials provided with the
+ *     distribution.
+ *   * Neither the name of Nemo Mobile nor the names of its contributors
+ *     may be used to endorse or promote products derived from this
+ *     software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef QUSBMODEDPOOL_H
+#define QUSBMODEDPOOL_H
+
+#include "qusbmoded.h"
+
+#include <QVariant>
+
+class QUsbModedClock;
+
+// Monitors usb_moded on many D-Bus endpoints (e.g. forwarded device
+// buses) from one process. QUsbModed instances are spread across a
+// fixed set of dispatch threads and started in batches. Every property
+// change of every endpoint is reported by the changed() signal. An
+// endpoint that doesn't become ready within startupTimeout gets reported
+// by endpointFailed() and stops holding up the rest of the batch.
+class QUSBMODED_EXPORT QUsbModedPool : public QObject
+{
+    Q_OBJECT
+    Q_PROPERTY(int count READ count NOTIFY countChanged)
+    Q_PROPERTY(int readyCount READ readyCount NOTIFY readyCountChanged)
+    Q_PROPERTY(int startupBatchSize READ startupBatchSize WRITE setStartupBatchSize)
+    Q_PROPERTY(int startupTimeout READ startupTimeout WRITE setStartupTimeout)
+
+public:
+    static const int DefaultStartupBatchSize = 8;
+    static const int DefaultStartupTimeout = 10000; // ms
+
+    // Zero threads means that everything runs on the calling thread
+    explicit QUsbModedPool(int threadCount = 1, QObject* parent = nullptr);
+    ~QUsbModedPool();
+
+    int threadCount() const;
+    int count() const;
+    int readyCount() const;
+    int startupBatchSize() const;
+    void setStartupBatchSize(int size);
+    int startupTimeout() const;
+    void setStartupTimeout(int ms);
+    QStringList endpoints() const;
+
+    // Time source for the startup timeout. Must outlive the pool, null
+    // selects the system clock.
+    QUsbModedClock* clock() const;
+    void setClock(QUsbModedClock* clock);
+
+    bool addEndpoint(const QString &name, const QString &address);
+    bool removeEndpoint(const QString &name);
+
+    bool isReady(const QString &name) const;
+
+    // The QUsbModed instances live in the dispatch threads, requests are
+    // queued to the thread of the endpoint. Returns false if the endpoint
+    // hasn't been started or couldn't connect to its bus.
+    bool setCurrentMode(const QString &name, const QString &mode);
+
+Q_SIGNALS:
+    void countChanged();
+    void readyCountChanged();
+    void endpointReady(QString name);
+    void endpointFailed(QString name, QString error);
+    void changed(QString endpoint, QString property, QVariant value);
+
+private Q_SLOTS:
+    void onStartFinished(const QString &name, uint serial);
+    void onFailed(const QString &name, uint serial, const QString &error);
+    void onAvailableChanged(const QString &name, uint serial, bool available);
+
+private:
+    void startNext();
+    void startTimeout(const QString &name);
+
+private:
+    class Private;
+    Private* iPrivate;
+};
+
+#endif // QUSBMODEDPOOL_H
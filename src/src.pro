@@ -10,11 +10,18 @@ DEFINES += QUSBMODED_LIBRARY
 
 SOURCES += \
     qusbmode.cpp \
-    qusbmoded.cpp
+    qusbmoded.cpp \
+    qusbmoded_compat.cpp \
+    qusbmodedclock.cpp \
+    qusbmodedconfigvalue.cpp \
+    qusbmodedpool.cpp
 
 PUBLIC_HEADERS += \
     qusbmode.h \
     qusbmoded.h \
+    qusbmodedclock.h \
+    qusbmodedconfigvalue.h \
+    qusbmodedpool.h \
     qusbmoded_types.h
 
 HEADERS += \
@@ -0,0 +1,176 @@
+/*
+ * Copyright (C) 2026 Jolla Ltd.
+ *
+ * You may use this file under the terms of the BSD license as follows:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in
+ *     the documentation and/or other materials provided with the
+ *     distribution.
+ *   * Neither the name of Nemo Mobile nor the names of its contributors
+ *     may be used to endorse or promote products derived from this
+ *     software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "qusbmodedpool.h"
+
+#include "testbus.h"
+#include "testusbmoded.h"
+
+#include <QElapsedTimer>
+#include <QtTest>
+
+// How QUsbModedPool scales with the number of endpoints and dispatch
+// threads. The endpoints are spread over a set of stand-in usb_moded
+// daemons, each on its own private bus, each endpoint having its own
+// connection.
+class BenchPool : public QObject
+{
+    Q_OBJECT
+
+public:
+    static const int Daemons = 8;
+
+private Q_SLOTS:
+    void initTestCase();
+    void cleanupTestCase();
+    void startup_data();
+    void startup();
+    void broadcast_data();
+    void broadcast();
+
+private:
+    void addRows();
+    void addEndpoints(QUsbModedPool* pool, int count);
+
+private:
+    QList<TestBus*> iBuses;
+    QList<TestUsbModed*> iUsbModeds;
+};
+
+void BenchPool::initTestCase()
+{
+    for (int i = 0; i < Daemons; i++) {
+        TestBus* bus = new TestBus;
+        iBuses.append(bus);
+        if (!bus->start()) {
+            QSKIP("dbus-daemon is not available");
+        }
+        TestUsbModed* usbModed = new TestUsbModed(bus->connect(QStringLiteral("usbmoded")));
+        iUsbModeds.append(usbModed);
+        QVERIFY(usbModed->registerService());
+    }
+}
+
+void BenchPool::cleanupTestCase()
+{
+    // The stand-ins go before their buses
+    qDeleteAll(iUsbModeds);
+    iUsbModeds.clear();
+    qDeleteAll(iBuses);
+    iBuses.clear();
+}
+
+void BenchPool::addEndpoints(QUsbModedPool* aPool, int aCount)
+{
+    for (int i = 0; i < aCount; i++) {
+        aPool->addEndpoint(QString::number(i), iBuses.at(i % Daemons)->address());
+    }
+}
+
+void BenchPool::addRows()
+{
+    QTest::addColumn<int>("endpoints");
+    QTest::addColumn<int>("threads");
+    static const int endpoints[] = { 16, 128, 512 };
+    static const int threads[] = { 1, 4, 8 };
+    for (uint i = 0; i < sizeof(endpoints)/sizeof(endpoints[0]); i++) {
+        for (uint k = 0; k < sizeof(threads)/sizeof(threads[0]); k++) {
+            const QByteArray name(QString::fromLatin1("%1 endpoints, %2 threads").
+                arg(endpoints[i]).arg(threads[k]).toLatin1());
+            QTest::newRow(name.constData()) << endpoints[i] << threads[k];
+        }
+    }
+}
+
+void BenchPool::startup_data()
+{
+    addRows();
+}
+
+void BenchPool::startup()
+{
+    // Time until every endpoint is ready
+    QFETCH(int, endpoints);
+    QFETCH(int, threads);
+    QUsbModedPool pool(threads);
+    QBENCHMARK_ONCE {
+        addEndpoints(&pool, endpoints);
+        QTRY_COMPARE_WITH_TIMEOUT(pool.readyCount(), endpoints, 120000);
+    }
+}
+
+void BenchPool::broadcast_data()
+{
+    addRows();
+}
+
+void BenchPool::broadcast()
+{
+    // Time it takes for a state change on every daemon to reach every
+    // endpoint
+    QFETCH(int, endpoints);
+    QFETCH(int, threads);
+    QUsbModedPool pool(threads);
+    addEndpoints(&pool, endpoints);
+    QTRY_COMPARE_WITH_TIMEOUT(pool.readyCount(), endpoints, 120000);
+
+    int received = 0;
+    QString mode;
+    connect(&pool, &QUsbModedPool::changed, this,
+        [&received, &mode](const QString &, const QString &aProperty,
+        const QVariant &aValue) {
+        if (aProperty == QStringLiteral("currentMode") &&
+            aValue.toString() == mode) {
+            received++;
+        }
+    });
+
+    int round = 0;
+    qint64 worst = 0;
+    QBENCHMARK {
+        QElapsedTimer timer;
+        timer.start();
+        received = 0;
+        mode = (round++ % 2) ? QUsbMode::Mode::MTP : QUsbMode::Mode::Charging;
+        for (int i = 0; i < Daemons; i++) {
+            iUsbModeds.at(i)->setCurrentState(mode);
+        }
+        QTRY_COMPARE_WITH_TIMEOUT(received, endpoints, 60000);
+        worst = qMax(worst, timer.nsecsElapsed());
+    }
+    qInfo("worst case %.3f ms, %.1f us per endpoint", worst / 1000000.0,
+        worst / 1000.0 / endpoints);
+}
+
+QTEST_MAIN(BenchPool)
+
+#include "bench_pool.moc"
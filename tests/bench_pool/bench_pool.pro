@@ -0,0 +1,7 @@
+TEMPLATE = app
+TARGET = bench_pool
+
+include(../common/common.pri)
+
+SOURCES += \
+    bench_pool.cpp
@@ -0,0 +1,431 @@
+/*
+ * Copyright (C) 2026 Jolla Ltd.
+ *
+ * You may use this file under the terms of the BSD license as follows:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in
+ *     the documentation and/or other materials provided with the
+ *     distribution.
+ *   * Neither the name of Nemo Mobile nor the names of its contributors
+ *     may be used to endorse or promote products derived from this
+ *     software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "qusbmoded.h"
+#include "qusbmodedconfigvalue.h"
+
+#include <QMetaMethod>
+#include <QtTest>
+
+#ifdef __GLIBC__
+#  include <malloc.h>
+#  define HEAP_COUNTERS
+#endif
+
+#ifdef HEAP_COUNTERS
+
+// Every heap allocation in the process, including the ones made by Qt,
+// goes through these. glibc exports the real implementation as __libc_*
+extern "C" {
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t count, size_t size);
+void* __libc_realloc(void* ptr, size_t size);
+void __libc_free(void* ptr);
+}
+
+static QBasicAtomicInteger<qint64> heapAllocations = Q_BASIC_ATOMIC_INITIALIZER(0);
+static QBasicAtomicInteger<qint64> heapBytes = Q_BASIC_ATOMIC_INITIALIZER(0);
+
+static void* countAllocation(void* aPtr)
+{
+    if (aPtr) {
+        heapAllocations.fetchAndAddRelaxed(1);
+        heapBytes.fetchAndAddRelaxed(malloc_usable_size(aPtr));
+    }
+    return aPtr;
+}
+
+extern "C" void* malloc(size_t aSize) __THROW
+{
+    return countAllocation(__libc_malloc(aSize));
+}
+
+extern "C" void* calloc(size_t aCount, size_t aSize) __THROW
+{
+    return countAllocation(__libc_calloc(aCount, aSize));
+}
+
+extern "C" void* realloc(void* aPtr, size_t aSize) __THROW
+{
+    const qint64 oldSize = aPtr ? malloc_usable_size(aPtr) : 0;
+    void* ptr = __libc_realloc(aPtr, aSize);
+    if (ptr || !aSize) {
+        heapBytes.fetchAndAddRelaxed(-oldSize);
+        countAllocation(ptr);
+    }
+    return ptr;
+}
+
+extern "C" void free(void* aPtr) __THROW
+{
+    if (aPtr) {
+        heapBytes.fetchAndAddRelaxed(-qint64(malloc_usable_size(aPtr)));
+    }
+    __libc_free(aPtr);
+}
+
+// Heap block holding the string data, zero for static data
+static qint64 stringBytes(QString aString)
+{
+    QString::DataPtr data = aString.data_ptr();
+    return data->ref.isStatic() ? 0 : malloc_usable_size(data);
+}
+
+#endif // HEAP_COUNTERS
+
+// Number of QString instances sharing the data
+static int refCount(const QString &aString)
+{
+    return const_cast<QString&>(aString).data_ptr()->ref.atomic.load();
+}
+
+static const char SupportedModes[] =
+    "charging_only, mtp_mode, developer_mode, connection_sharing, "
+    "pc_suite, diag_mode, adb_mode";
+static const char HiddenModes[] = "diag_mode, adb_mode";
+static const char CurrentMode[] = "mtp_mode";
+
+// Emits the signals of the generated usb_moded proxy, connected to
+// QUsbModed the same way as the proxy
+class UsbModedSignals : public QObject
+{
+    Q_OBJECT
+
+Q_SIGNALS:
+    void sig_usb_current_state_ind(const QString &mode);
+    void sig_usb_target_state_ind(const QString &mode);
+    void sig_usb_config_ind(const QString &section, const QString &key,
+        const QString &value);
+};
+
+// Gets called by QUsbModed in the middle of handling the signal and
+// records the reference count of the string being dispatched
+class DispatchProbe : public QObject
+{
+    Q_OBJECT
+
+public:
+    DispatchProbe() : iString(nullptr), iRefs(0) {}
+
+public Q_SLOTS:
+    void check();
+
+public:
+    const QString* iString;
+    int iRefs;
+};
+
+void DispatchProbe::check()
+{
+    if (iString) {
+        iRefs = qMax(iRefs, refCount(*iString));
+    }
+}
+
+// Heap cost of QUsbModed instances and of the updates coming from
+// usb_moded. The updates are delivered straight to the slots that the
+// D-Bus signals are connected to, so QtDBus unmarshalling isn't counted.
+// The instances sit on a bus that isn't connected to anything.
+class BenchQUsbModed : public QObject
+{
+    Q_OBJECT
+
+public:
+    BenchQUsbModed() : iBus(QStringLiteral("bench_qusbmoded")) {}
+
+private Q_SLOTS:
+    void initTestCase();
+    void modeSharing();
+    void bytesPerInstance_data();
+    void bytesPerInstance();
+    void allocationsPerSignal_data();
+    void allocationsPerSignal();
+    void signalArguments_data();
+    void signalArguments();
+
+private:
+    static void invoke(QObject* object, const char* slot, const QString &arg);
+    static void populate(QUsbModed* usbModed);
+
+private:
+    QDBusConnection iBus;
+};
+
+void BenchQUsbModed::initTestCase()
+{
+#ifndef HEAP_COUNTERS
+    QSKIP("Heap counters require glibc");
+#endif
+    QVERIFY(!iBus.isConnected());
+}
+
+void BenchQUsbModed::invoke(QObject* aObject, const char* aSlot,
+    const QString &aArg)
+{
+    const QMetaObject* meta = aObject->metaObject();
+    const int index = meta->indexOfSlot(aSlot);
+    QVERIFY(index >= 0);
+    QVERIFY(meta->method(index).invoke(aObject, Qt::DirectConnection,
+        Q_ARG(QString, aArg)));
+}
+
+// Same strings as usb_moded would send, each one freshly allocated
+// like the ones coming out of QtDBus
+void BenchQUsbModed::populate(QUsbModed* aUsbModed)
+{
+    invoke(aUsbModed, "onUsbSupportedModesChanged(QString)",
+        QString::fromLatin1(SupportedModes));
+    invoke(aUsbModed, "onUsbHiddenModesChanged(QString)",
+        QString::fromLatin1(HiddenModes));
+    invoke(aUsbModed, "onUsbStateChanged(QString)",
+        QString::fromLatin1(CurrentMode));
+}
+
+void BenchQUsbModed::modeSharing()
+{
+    QUsbModed first(iBus);
+    QUsbModed second(iBus);
+    populate(&first);
+    populate(&second);
+
+    const QStringList modes1(first.supportedModes());
+    const QStringList modes2(second.supportedModes());
+    QCOMPARE(modes1, modes2);
+    QCOMPARE(modes1.count(), 7);
+    for (int i=0; i<modes1.count(); i++) {
+        QVERIFY(modes1.at(i).constData() == modes2.at(i).constData());
+    }
+    QVERIFY(first.currentMode().constData() ==
+        second.currentMode().constData());
+    QVERIFY(first.currentMode().constData() ==
+        modes1.at(1).constData());
+}
+
+void BenchQUsbModed::bytesPerInstance_data()
+{
+    QTest::addColumn<int>("count");
+    QTest::newRow("1") << 1;
+    QTest::newRow("16") << 16;
+    QTest::newRow("256") << 256;
+}
+
+void BenchQUsbModed::bytesPerInstance()
+{
+#ifdef HEAP_COUNTERS
+    QFETCH(int, count);
+
+    // The first instance creates the shared connection and interns the
+    // mode names, that's a one time cost
+    QUsbModed first(iBus);
+    populate(&first);
+
+    QList<QUsbModed*> list;
+    list.reserve(count);
+    const qint64 allocations = heapAllocations.load();
+    const qint64 bytes = heapBytes.load();
+    for (int i=0; i<count; i++) {
+        QUsbModed* usbModed = new QUsbModed(iBus);
+        populate(usbModed);
+        list.append(usbModed);
+    }
+    const qint64 totalAllocations = heapAllocations.load() - allocations;
+    const qint64 totalBytes = heapBytes.load() - bytes;
+
+    // What the mode names would take if each instance had its own copy
+    qint64 shared = 0;
+    const QStringList modes(first.supportedModes() + first.hiddenModes());
+    for (int i=0; i<modes.count(); i++) {
+        shared += stringBytes(modes.at(i));
+    }
+    shared += stringBytes(first.currentMode());
+
+    qDeleteAll(list);
+    qInfo("%d instance(s): %lld bytes and %lld allocations per instance, "
+        "%lld bytes of mode names shared", count, totalBytes / count,
+        totalAllocations / count, shared);
+#endif
+}
+
+void BenchQUsbModed::allocationsPerSignal_data()
+{
+    QTest::addColumn<QByteArray>("slot");
+    QTest::addColumn<QString>("value1");
+    QTest::addColumn<QString>("value2");
+
+    const QString supported(QString::fromLatin1(SupportedModes));
+    const QString fewer(QStringLiteral("charging_only, mtp_mode, developer_mode"));
+    const QString hidden(QString::fromLatin1(HiddenModes));
+    QTest::newRow("supported modes, changed")
+        << QByteArray("onUsbSupportedModesChanged(QString)") << supported << fewer;
+    QTest::newRow("supported modes, same")
+        << QByteArray("onUsbSupportedModesChanged(QString)") << supported << supported;
+    QTest::newRow("hidden modes, changed")
+        << QByteArray("onUsbHiddenModesChanged(QString)") << hidden << QString();
+    QTest::newRow("hidden modes, same")
+        << QByteArray("onUsbHiddenModesChanged(QString)") << hidden << hidden;
+    QTest::newRow("current state, changed")
+        << QByteArray("onUsbStateChanged(QString)")
+        << QString::fromLatin1(CurrentMode) << QStringLiteral("charging_only");
+    QTest::newRow("current state, same")
+        << QByteArray("onUsbStateChanged(QString)")
+        << QString::fromLatin1(CurrentMode) << QString::fromLatin1(CurrentMode);
+}
+
+void BenchQUsbModed::allocationsPerSignal()
+{
+#ifdef HEAP_COUNTERS
+    static const int Count = 1000;
+    QFETCH(QByteArray, slot);
+    QFETCH(QString, value1);
+    QFETCH(QString, value2);
+
+    QUsbModed usbModed(iBus);
+    populate(&usbModed);
+
+    // Separate copies, allocated before we start counting
+    QStringList values;
+    values.reserve(Count);
+    for (int i=0; i<Count; i++) {
+        const QString &value = (i % 2) ? value2 : value1;
+        values.append(QString(value.constData(), value.size()));
+    }
+
+    const QMetaObject* meta = usbModed.metaObject();
+    const QMetaMethod method(meta->method(meta->indexOfSlot(slot.constData())));
+    QVERIFY(method.isValid());
+
+    const qint64 allocations = heapAllocations.load();
+    const qint64 bytes = heapBytes.load();
+    for (int i=0; i<Count; i++) {
+        method.invoke(&usbModed, Qt::DirectConnection,
+            Q_ARG(QString, values.at(i)));
+    }
+    const qint64 totalAllocations = heapAllocations.load() - allocations;
+    const qint64 retainedBytes = heapBytes.load() - bytes;
+
+    // Whatever is kept must not grow with the number of updates
+    QVERIFY(retainedBytes < 1024);
+    qInfo("%s: %.2f allocations per signal", QTest::currentDataTag(),
+        double(totalAllocations) / Count);
+#endif
+}
+
+void BenchQUsbModed::signalArguments_data()
+{
+    QTest::addColumn<int>("signal");
+    QTest::addColumn<int>("references");
+
+    // Only the config value is supposed to be kept, that's the cache
+    QTest::newRow("current state") << 0 << 0;
+    QTest::newRow("target state") << 1 << 0;
+    QTest::newRow("config value") << 2 << 1;
+}
+
+void BenchQUsbModed::signalArguments()
+{
+#ifdef HEAP_COUNTERS
+    static const int Count = 1000;
+    QFETCH(int, signal);
+    QFETCH(int, references);
+
+    QUsbModed usbModed(iBus);
+    UsbModedSignals proxy;
+    QVERIFY(usbModed.connect(&proxy,
+        SIGNAL(sig_usb_current_state_ind(QString)),
+        SLOT(onUsbStateChanged(QString))));
+    QVERIFY(usbModed.connect(&proxy,
+        SIGNAL(sig_usb_target_state_ind(QString)),
+        SLOT(onUsbTargetStateChanged(QString))));
+    QVERIFY(usbModed.connect(&proxy,
+        SIGNAL(sig_usb_config_ind(QString,QString,QString)),
+        SLOT(onUsbConfigChanged(QString,QString,QString))));
+
+    const QString section(QStringLiteral("network"));
+    const QString key(QStringLiteral("ip"));
+    QUsbModedConfigValue configValue(&usbModed, section, key);
+    DispatchProbe probe;
+    connect(&usbModed, SIGNAL(currentModeChanged()), &probe, SLOT(check()));
+    connect(&usbModed, SIGNAL(targetModeChanged()), &probe, SLOT(check()));
+    connect(&configValue, SIGNAL(valueChanged()), &probe, SLOT(check()));
+
+    // Every other signal changes the value, so that QUsbModed gets to
+    // the notifications. Separate copies, like the ones coming out of
+    // QtDBus, allocated before we start counting.
+    const QString value1(QString::fromLatin1(CurrentMode));
+    const QString value2(QStringLiteral("charging_only"));
+    QStringList values;
+    values.reserve(Count);
+    for (int i=0; i<Count; i++) {
+        const QString &value = (i % 2) ? value2 : value1;
+        values.append(QString(value.constData(), value.size()));
+    }
+
+    // Interns the values
+    Q_EMIT proxy.sig_usb_current_state_ind(value2);
+    Q_EMIT proxy.sig_usb_target_state_ind(value2);
+    Q_EMIT proxy.sig_usb_config_ind(section, key, value2);
+
+    int copies = 0;
+    const qint64 allocations = heapAllocations.load();
+    for (int i=0; i<Count; i++) {
+        const QString &value = values.at(i);
+        const int refs = refCount(value);
+        probe.iString = &value;
+        probe.iRefs = 0;
+        switch (signal) {
+        case 0:
+            Q_EMIT proxy.sig_usb_current_state_ind(value);
+            break;
+        case 1:
+            Q_EMIT proxy.sig_usb_target_state_ind(value);
+            break;
+        default:
+            Q_EMIT proxy.sig_usb_config_ind(section, key, value);
+            break;
+        }
+        copies = qMax(copies, probe.iRefs - refs);
+    }
+    probe.iString = nullptr;
+    const qint64 totalAllocations = heapAllocations.load() - allocations;
+
+    // A by-value slot anywhere on the way adds a reference. Each one is
+    // an atomic increment and an atomic decrement per signal.
+    QCOMPARE(copies, references);
+    qInfo("%s: %d extra reference(s), %.2f allocations per signal",
+        QTest::currentDataTag(), copies, double(totalAllocations) / Count);
+#endif
+}
+
+QTEST_GUILESS_MAIN(BenchQUsbModed)
+
+#include "bench_qusbmoded.moc"
@@ -0,0 +1,7 @@
+TEMPLATE = app
+TARGET = bench_qusbmoded
+
+include(../common/common.pri)
+
+SOURCES += \
+    bench_qusbmoded.cpp
@@ -0,0 +1,18 @@
+QT += dbus testlib
+QT -= gui
+CONFIG += link_pkgconfig no_testcase_installs
+PKGCONFIG += usb_moded
+
+INCLUDEPATH += $$PWD ../../src
+LIBS += -L$$OUT_PWD/../../src -lusb-moded-qt$${QT_MAJOR_VERSION}
+QMAKE_RPATHDIR += $$OUT_PWD/../../src
+
+HEADERS += \
+    $$PWD/modelist.h \
+    $$PWD/testbus.h \
+    $$PWD/testusbmoded.h
+
+SOURCES += \
+    $$PWD/modelist.cpp \
+    $$PWD/testbus.cpp \
+    $$PWD/testusbmoded.cpp
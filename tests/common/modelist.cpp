@@ -0,0 +1,84 @@
+/*
+ * Copyright (C) 2026 Jolla Ltd.
+ *
+ * You may use this file under the terms of the BSD license as follows:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in
+ *     the documentation and/or other materials provided with the
+ *     distribution.
+ *   * Neither the name of Nemo Mobile nor the names of its contributors
+ *     may be used to endorse or promote products derived from this
+ *     software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "modelist.h"
+
+QStringList ModeList::parse(const QString &aModes)
+{
+    QStringList modes;
+    const QStringList parts(aModes.split(QLatin1Char(',')));
+    for (int i=0; i<parts.count(); i++) {
+        const QString mode(parts.at(i).trimmed());
+        if (!mode.isEmpty() && !modes.contains(mode)) {
+            modes.append(mode);
+        }
+    }
+    return modes;
+}
+
+QString ModeList::check(const QStringList &aModes)
+{
+    for (int i=0; i<aModes.count(); i++) {
+        const QString &mode = aModes.at(i);
+        if (mode.isEmpty()) {
+            return QStringLiteral("empty entry at %1").arg(i);
+        } else if (mode != mode.trimmed()) {
+            return QStringLiteral("untrimmed entry '%1'").arg(mode);
+        } else if (mode.contains(QLatin1Char(','))) {
+            return QStringLiteral("unsplit entry '%1'").arg(mode);
+        } else if (aModes.indexOf(mode) != i) {
+            return QStringLiteral("duplicate entry '%1'").arg(mode);
+        }
+    }
+    return QString();
+}
+
+ModeSlot::ModeSlot(QObject* aObject, const char* aSignature) :
+    iObject(aObject)
+{
+    const QMetaObject* meta = aObject->metaObject();
+    const int index = meta->indexOfSlot(aSignature);
+    if (index >= 0) {
+        iMethod = meta->method(index);
+    }
+}
+
+bool ModeSlot::isValid() const
+{
+    return iMethod.isValid();
+}
+
+void ModeSlot::deliver(const QString &aValue) const
+{
+    iMethod.invoke(iObject, Qt::DirectConnection, Q_ARG(QString, aValue));
+}
@@ -0,0 +1,93 @@
+/*
+ * Copyright (C) 2026 Jolla Ltd.
+ *
+ * You may use this file under the terms of the BSD license as follows:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in
+ *     the documentation and/or other materials provided with the
+ *     distribution.
+ *   * Neither the name of Nemo Mobile nor the names of its contributors
+ *     may be used to endorse or promote products derived from this
+ *     software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "testbus.h"
+
+#include <QProcess>
+#include <QStandardPaths>
+
+TestBus::TestBus() :
+    iDaemon(nullptr)
+{
+}
+
+TestBus::~TestBus()
+{
+    const int n = iConnections.count();
+    for (int i=0; i<n; i++) {
+        QDBusConnection::disconnectFromBus(iConnections.at(i));
+    }
+    if (iDaemon) {
+        iDaemon->terminate();
+        if (!iDaemon->waitForFinished(5000)) {
+            iDaemon->kill();
+            iDaemon->waitForFinished(5000);
+        }
+        delete iDaemon;
+    }
+}
+
+bool TestBus::start()
+{
+    if (!iDaemon) {
+        const QString exe(QStandardPaths::findExecutable(QStringLiteral("dbus-daemon")));
+        if (exe.isEmpty()) {
+            return false;
+        }
+        iDaemon = new QProcess;
+        iDaemon->setProcessChannelMode(QProcess::ForwardedErrorChannel);
+        iDaemon->start(exe, QStringList() << QStringLiteral("--session") <<
+            QStringLiteral("--nofork") << QStringLiteral("--print-address"));
+        if (!iDaemon->waitForStarted()) {
+            return false;
+        }
+        while (!iDaemon->canReadLine()) {
+            if (!iDaemon->waitForReadyRead()) {
+                return false;
+            }
+        }
+        iAddress = QString::fromLatin1(iDaemon->readLine().trimmed());
+    }
+    return !iAddress.isEmpty();
+}
+
+QString TestBus::address() const
+{
+    return iAddress;
+}
+
+QDBusConnection TestBus::connect(const QString &aName)
+{
+    iConnections.append(aName);
+    return QDBusConnection::connectToBus(iAddress, aName);
+}
@@ -0,0 +1,215 @@
+/*
+ * Copyright (C) 2026 Jolla Ltd.
+ *
+ * You may use this file under the terms of the BSD license as follows:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in
+ *     the documentation and/or other materials provided with the
+ *     distribution.
+ *   * Neither the name of Nemo Mobile nor the names of its contributors
+ *     may be used to endorse or promote products derived from this
+ *     software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "testusbmoded.h"
+
+#include "qusbmode.h"
+
+#include "usb_moded-dbus.h"
+
+TestUsbModed::TestUsbModed(const QDBusConnection &aBus, QObject* aParent) :
+    QObject(aParent),
+    iBus(aBus),
+    iCurrentMode(QUsbMode::Mode::Disconnected),
+    iTargetMode(QUsbMode::Mode::Disconnected),
+    iConfigMode(QUsbMode::Mode::Ask),
+    iAutoSwitch(true),
+    iHung(false)
+{
+    iSupportedModes << QUsbMode::Mode::Charging << QUsbMode::Mode::MTP <<
+        QUsbMode::Mode::Developer;
+}
+
+TestUsbModed::~TestUsbModed()
+{
+    unregisterService();
+}
+
+bool TestUsbModed::registerService()
+{
+    return iBus.registerObject(USB_MODE_OBJECT, this,
+        QDBusConnection::ExportAllSlots | QDBusConnection::ExportAllSignals) &&
+        iBus.registerService(USB_MODE_SERVICE);
+}
+
+void TestUsbModed::unregisterService()
+{
+    iBus.unregisterService(USB_MODE_SERVICE);
+    iBus.unregisterObject(USB_MODE_OBJECT);
+}
+
+void TestUsbModed::setCurrentState(const QString &aMode)
+{
+    iCurrentMode = aMode;
+    Q_EMIT sig_usb_current_state_ind(aMode);
+}
+
+void TestUsbModed::setTargetState(const QString &aMode)
+{
+    iTargetMode = aMode;
+    Q_EMIT sig_usb_target_state_ind(aMode);
+}
+
+void TestUsbModed::sendEvent(const QString &aEvent)
+{
+    Q_EMIT sig_usb_event_ind(aEvent);
+}
+
+void TestUsbModed::setSupportedModes(const QStringList &aModes)
+{
+    iSupportedModes = aModes;
+    Q_EMIT sig_usb_supported_modes_ind(aModes.join(','));
+    Q_EMIT sig_usb_available_modes_ind(aModes.join(','));
+}
+
+void TestUsbModed::setHiddenModes(const QStringList &aModes)
+{
+    iHiddenModes = aModes;
+    Q_EMIT sig_usb_hidden_modes_ind(aModes.join(','));
+}
+
+void TestUsbModed::setConfigValue(const QString &aSect, const QString &aKey,
+    const QString &aValue)
+{
+    Q_EMIT sig_usb_config_ind(aSect, aKey, aValue);
+}
+
+void TestUsbModed::setAutoSwitch(bool aAutoSwitch)
+{
+    iAutoSwitch = aAutoSwitch;
+}
+
+void TestUsbModed::setHung(bool aHung)
+{
+    if (iHung != aHung) {
+        iHung = aHung;
+        if (!aHung) {
+            const int n = iDelayedCalls.count();
+            for (int i=0; i<n; i++) {
+                iBus.send(iDelayedCalls.at(i).createReply(iDelayedReplies.at(i)));
+            }
+            iDelayedCalls.clear();
+            iDelayedReplies.clear();
+        }
+    }
+}
+
+int TestUsbModed::callCount(const QString &aMethod) const
+{
+    return iCalls.value(aMethod);
+}
+
+QString TestUsbModed::reply(const QString &aMethod, const QString &aValue)
+{
+    iCalls[aMethod]++;
+    if (iHung && calledFromDBus()) {
+        setDelayedReply(true);
+        iDelayedCalls.append(message());
+        iDelayedReplies.append(aValue);
+    }
+    return aValue;
+}
+
+QString TestUsbModed::mode_request()
+{
+    return reply(QStringLiteral("mode_request"), iCurrentMode);
+}
+
+QString TestUsbModed::get_target_state()
+{
+    return reply(QStringLiteral("get_target_state"), iTargetMode);
+}
+
+QString TestUsbModed::get_modes()
+{
+    return reply(QStringLiteral("get_modes"), iSupportedModes.join(','));
+}
+
+QString TestUsbModed::get_available_modes_for_user()
+{
+    return reply(QStringLiteral("get_available_modes_for_user"),
+        iSupportedModes.join(','));
+}
+
+QString TestUsbModed::get_config()
+{
+    return reply(QStringLiteral("get_config"), iConfigMode);
+}
+
+QString TestUsbModed::get_hidden()
+{
+    return reply(QStringLiteral("get_hidden"), iHiddenModes.join(','));
+}
+
+QString TestUsbModed::set_mode(const QString &aMode)
+{
+    const QString result(reply(QStringLiteral("set_mode"), aMode));
+    if (!iHung) {
+        setTargetState(aMode);
+        if (iAutoSwitch) {
+            setCurrentState(QUsbMode::Mode::Busy);
+            setCurrentState(aMode);
+        }
+    }
+    return result;
+}
+
+QString TestUsbModed::set_config(const QString &aConfig)
+{
+    const QString result(reply(QStringLiteral("set_config"), aConfig));
+    if (!iHung) {
+        iConfigMode = aConfig;
+        setConfigValue(QStringLiteral("usbmode"), QStringLiteral("mode"), aConfig);
+    }
+    return result;
+}
+
+QString TestUsbModed::hide_mode(const QString &aMode)
+{
+    const QString result(reply(QStringLiteral("hide_mode"), aMode));
+    if (!iHung && !iHiddenModes.contains(aMode)) {
+        setHiddenModes(QStringList(iHiddenModes) << aMode);
+    }
+    return result;
+}
+
+QString TestUsbModed::unhide_mode(const QString &aMode)
+{
+    const QString result(reply(QStringLiteral("unhide_mode"), aMode));
+    if (!iHung && iHiddenModes.contains(aMode)) {
+        QStringList modes(iHiddenModes);
+        modes.removeAll(aMode);
+        setHiddenModes(modes);
+    }
+    return result;
+}
@@ -0,0 +1,114 @@
+/*
+ * Copyright (C) 2026 Jolla Ltd.
+ *
+ * You may use this file under the terms of the BSD license as follows:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in
+ *     the documentation and/or other materials provided with the
+ *     distribution.
+ *   * Neither the name of Nemo Mobile nor the names of its contributors
+ *     may be used to endorse or promote products derived from this
+ *     software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef TESTUSBMODED_H
+#define TESTUSBMODED_H
+
+#include <QDBusConnection>
+#include <QDBusContext>
+#include <QDBusMessage>
+#include <QHash>
+#include <QObject>
+#include <QStringList>
+
+// Stand-in for usb_moded. Implements the part of com.meego.usb_moded
+// that QUsbModed uses, the test drives the state and the signals.
+class TestUsbModed : public QObject, protected QDBusContext
+{
+    Q_OBJECT
+    Q_CLASSINFO("D-Bus Interface", "com.meego.usb_moded")
+
+public:
+    TestUsbModed(const QDBusConnection &bus, QObject* parent = nullptr);
+    ~TestUsbModed();
+
+    bool registerService();
+    void unregisterService();
+
+    // Each of these emits the respective signal
+    void setCurrentState(const QString &mode);
+    void setTargetState(const QString &mode);
+    void sendEvent(const QString &event);
+    void setSupportedModes(const QStringList &modes);
+    void setHiddenModes(const QStringList &modes);
+    void setConfigValue(const QString &section, const QString &key, const QString &value);
+
+    // With auto switch (the default) set_mode goes through the busy
+    // state to the requested mode, otherwise only the target changes
+    void setAutoSwitch(bool autoSwitch);
+
+    // Hung usb_moded doesn't reply until it gets unhung
+    void setHung(bool hung);
+
+    int callCount(const QString &method) const;
+
+public Q_SLOTS:
+    QString mode_request();
+    QString get_target_state();
+    QString get_modes();
+    QString get_available_modes_for_user();
+    QString get_config();
+    QString get_hidden();
+    QString set_mode(const QString &mode);
+    QString set_config(const QString &config);
+    QString hide_mode(const QString &mode);
+    QString unhide_mode(const QString &mode);
+
+Q_SIGNALS:
+    void sig_usb_current_state_ind(const QString &mode);
+    void sig_usb_target_state_ind(const QString &mode);
+    void sig_usb_event_ind(const QString &event);
+    void sig_usb_supported_modes_ind(const QString &modes);
+    void sig_usb_available_modes_ind(const QString &modes);
+    void sig_usb_hidden_modes_ind(const QString &modes);
+    void sig_usb_config_ind(const QString &section, const QString &key, const QString &value);
+    void sig_usb_state_error_ind(const QString &error);
+
+private:
+    QString reply(const QString &method, const QString &value);
+
+private:
+    QDBusConnection iBus;
+    QString iCurrentMode;
+    QString iTargetMode;
+    QString iConfigMode;
+    QStringList iSupportedModes;
+    QStringList iHiddenModes;
+    QHash<QString,int> iCalls;
+    QList<QDBusMessage> iDelayedCalls;
+    QStringList iDelayedReplies;
+    bool iAutoSwitch;
+    bool iHung;
+};
+
+#endif // TESTUSBMODED_H
@@ -0,0 +1,213 @@
+/*
+ * Copyright (C) 2026 Jolla Ltd.
+ *
+ * You may use this file under the terms of the BSD license as follows:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in
+ *     the documentation and/or other materials provided with the
+ *     distribution.
+ *   * Neither the name of Nemo Mobile nor the names of its contributors
+ *     may be used to endorse or promote products derived from this
+ *     software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "qusbmoded.h"
+
+#include "modelist.h"
+
+#include <QCoreApplication>
+#include <QFile>
+
+// Feeds arbitrary input to the slots that receive the supported and
+// hidden mode lists from usb_moded. The first byte selects the list,
+// the rest is taken as UTF-8. All inputs go to the same QUsbModed, so
+// that change detection gets checked against whatever came before.
+class FuzzModes
+{
+public:
+    FuzzModes();
+
+    void run(const uchar* data, size_t size);
+
+private:
+    struct List {
+        ModeSlot iSlot;
+        QStringList (QUsbModed::*iGet)() const;
+        QUsbModed::StateProperty iProperty;
+        int iChanges;
+    };
+
+    static void fail(const char* what, const QString &input);
+
+private:
+    QDBusConnection iBus;
+    QUsbModed iUsbModed;
+    List iLists[2];
+};
+
+FuzzModes::FuzzModes() :
+    iBus(QStringLiteral("fuzz_modes")),
+    iUsbModed(iBus),
+    iLists{
+        { ModeSlot(&iUsbModed, "onUsbSupportedModesChanged(QString)"),
+          &QUsbModed::supportedModes, QUsbModed::SupportedModesProperty, 0 },
+        { ModeSlot(&iUsbModed, "onUsbHiddenModesChanged(QString)"),
+          &QUsbModed::hiddenModes, QUsbModed::HiddenModesProperty, 0 }}
+{
+    if (!iLists[0].iSlot.isValid() || !iLists[1].iSlot.isValid()) {
+        qFatal("QUsbModed slots not found");
+    }
+    QObject::connect(&iUsbModed, &QUsbModed::supportedModesChanged,
+        [this]() { iLists[0].iChanges++; });
+    QObject::connect(&iUsbModed, &QUsbModed::hiddenModesChanged,
+        [this]() { iLists[1].iChanges++; });
+}
+
+void FuzzModes::fail(const char* aWhat, const QString &aInput)
+{
+    qFatal("%s, input \"%s\"", aWhat, aInput.toUtf8().constData());
+}
+
+void FuzzModes::run(const uchar* aData, size_t aSize)
+{
+    if (!aSize || aSize > 0x10000) {
+        return;
+    }
+
+    List &list = iLists[aData[0] % 2];
+    List &other = iLists[(aData[0] + 1) % 2];
+    const QString input(QString::fromUtf8((const char*)aData + 1, int(aSize - 1)));
+    const QStringList before((iUsbModed.*list.iGet)());
+    const uint version = iUsbModed.stateVersion(list.iProperty);
+    list.iChanges = other.iChanges = 0;
+
+    list.iSlot.deliver(input);
+
+    const QStringList after((iUsbModed.*list.iGet)());
+    const QString error(ModeList::check(after));
+    if (!error.isEmpty()) {
+        fail(qPrintable(error), input);
+    }
+    if (after != ModeList::parse(input)) {
+        fail("Unexpected mode list", input);
+    }
+    const bool changed = (after != before);
+    if (list.iChanges != (changed ? 1 : 0) || other.iChanges) {
+        fail(changed ? "Missing change signal" : "Spurious change signal", input);
+    }
+    if ((iUsbModed.stateVersion(list.iProperty) != version) != changed) {
+        fail("Unexpected state version", input);
+    }
+}
+
+// Never deleted, D-Bus objects can't outlive QCoreApplication
+static FuzzModes* fuzzModes()
+{
+    static FuzzModes* fuzz = new FuzzModes;
+    return fuzz;
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uchar* aData, size_t aSize)
+{
+    fuzzModes()->run(aData, aSize);
+    return 0;
+}
+
+#ifdef FUZZ_WITH_LIBFUZZER
+
+extern "C" int LLVMFuzzerInitialize(int* aArgc, char*** aArgv)
+{
+    new QCoreApplication(*aArgc, *aArgv);
+    return 0;
+}
+
+#else // FUZZ_WITH_LIBFUZZER
+
+// Pieces that matter to the parser. Random sequences of these cover
+// more ground than random bytes, which mostly end up as one long name.
+static const char* const Pieces[] = {
+    "charging_only", "mtp_mode", "developer_mode", "pc_suite",
+    "mtp_mode", "developer_mode", ",", ",", ",", " ", " ", "\t", "\n",
+    "\r", "\xc2\xa0", "\xe2\x80\x83", "\xc3\xa4", "\xff", "\xc3", "\0"
+};
+
+static const int PieceCount = sizeof(Pieces)/sizeof(Pieces[0]);
+static const int Iterations = 20000;
+
+// xorshift, so that every run sees the same inputs
+static quint32 nextRandom(quint32* aState)
+{
+    quint32 x = *aState;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return (*aState = x);
+}
+
+static QByteArray generate(quint32* aState)
+{
+    QByteArray input;
+    input.append(char(nextRandom(aState)));
+    const int n = nextRandom(aState) % 64;
+    for (int i=0; i<n; i++) {
+        const quint32 r = nextRandom(aState);
+        if (r % 16) {
+            const char* piece = Pieces[(r >> 4) % PieceCount];
+            input.append(piece, qMax<int>(qstrlen(piece), 1));
+        } else {
+            // Long custom configs with numbered modes
+            input.append("mode_");
+            input.append(QByteArray::number((r >> 4) % 48));
+        }
+    }
+    return input;
+}
+
+int main(int argc, char* argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    if (argc > 1) {
+        // Replays the given inputs (e.g. a crash found by libFuzzer)
+        for (int i=1; i<argc; i++) {
+            QFile file(QString::fromLocal8Bit(argv[i]));
+            if (!file.open(QIODevice::ReadOnly)) {
+                qWarning("Can't open %s", argv[i]);
+                return 1;
+            }
+            const QByteArray input(file.readAll());
+            LLVMFuzzerTestOneInput((const uchar*)input.constData(), input.size());
+        }
+        qInfo("%d input(s) OK", argc - 1);
+    } else {
+        quint32 state = 0x2545f491;
+        for (int i=0; i<Iterations; i++) {
+            const QByteArray input(generate(&state));
+            LLVMFuzzerTestOneInput((const uchar*)input.constData(), input.size());
+        }
+        qInfo("%d generated inputs OK", Iterations);
+    }
+    return 0;
+}
+
+#endif // FUZZ_WITH_LIBFUZZER
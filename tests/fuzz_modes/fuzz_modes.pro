@@ -0,0 +1,18 @@
+TEMPLATE = app
+TARGET = fuzz_modes
+CONFIG += testcase
+
+include(../common/common.pri)
+
+# qmake CONFIG+=libfuzzer (clang) builds a libFuzzer target. Otherwise
+# the standalone driver runs a fixed set of generated inputs, or the
+# files given on the command line.
+libfuzzer {
+    CONFIG -= testcase
+    DEFINES += FUZZ_WITH_LIBFUZZER
+    QMAKE_CXXFLAGS += -fsanitize=fuzzer,address
+    QMAKE_LFLAGS += -fsanitize=fuzzer,address
+}
+
+SOURCES += \
+    fuzz_modes.cpp
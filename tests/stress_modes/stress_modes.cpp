@@ -0,0 +1,223 @@
+/*
+ * Copyright (C) 2026 Jolla Ltd.
+ *
+ * You may use this file under the terms of the BSD license as follows:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in
+ *     the documentation and/or other materials provided with the
+ *     distribution.
+ *   * Neither the name of Nemo Mobile nor the names of its contributors
+ *     may be used to endorse or promote products derived from this
+ *     software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "qusbmoded.h"
+
+#include "modelist.h"
+
+#include <QElapsedTimer>
+#include <QSignalSpy>
+#include <QtTest>
+
+// Mode list updates at full speed, spread over several instances that
+// share the interned mode names. Every update is checked for duplicates,
+// order and change signals. Some of the updates repeat the current list
+// in a different form (whitespace, duplicates, empty entries), those
+// must not be reported as changes. Worst case time per update is
+// reported at the end.
+class StressModes : public QObject
+{
+    Q_OBJECT
+
+public:
+    StressModes() : iBus(QStringLiteral("stress_modes")), iRandom(0x9e3779b9) {}
+
+private Q_SLOTS:
+    void order();
+    void updates_data();
+    void updates();
+
+private:
+    quint32 random();
+    QString generate(int vocabulary, int maxLength);
+    QString reformat(const QStringList &modes);
+
+private:
+    QDBusConnection iBus;
+    quint32 iRandom;
+};
+
+// xorshift, the same sequence on every run
+quint32 StressModes::random()
+{
+    iRandom ^= iRandom << 13;
+    iRandom ^= iRandom >> 17;
+    iRandom ^= iRandom << 5;
+    return iRandom;
+}
+
+QString StressModes::generate(int aVocabulary, int aMaxLength)
+{
+    QStringList modes;
+    const int n = random() % (aMaxLength + 1);
+    for (int i=0; i<n; i++) {
+        modes.append(QStringLiteral("mode_%1").arg(random() % aVocabulary));
+    }
+    return modes.join(QLatin1Char(','));
+}
+
+// Same list as far as usb_moded clients are concerned
+QString StressModes::reformat(const QStringList &aModes)
+{
+    QString modes;
+    for (int i=0; i<aModes.count(); i++) {
+        switch (random() % 4) {
+        case 0: modes += QStringLiteral(" ,"); break;
+        case 1: modes += QStringLiteral("\t"); break;
+        default: break;
+        }
+        modes += aModes.at(i);
+        modes += QStringLiteral(" , ");
+        if (!(random() % 3)) {
+            // Repeats one of the modes seen so far
+            modes += aModes.at(random() % (i + 1));
+            modes += QLatin1Char(',');
+        }
+    }
+    return modes;
+}
+
+void StressModes::order()
+{
+    QUsbModed usbModed(iBus);
+    ModeSlot slot(&usbModed, "onUsbSupportedModesChanged(QString)");
+    QSignalSpy spy(&usbModed, SIGNAL(supportedModesChanged()));
+    QVERIFY(slot.isValid());
+
+    slot.deliver(QStringLiteral("mtp_mode, developer_mode,,charging_only"));
+    QCOMPARE(usbModed.supportedModes(), QStringList() << QStringLiteral("mtp_mode")
+        << QStringLiteral("developer_mode") << QStringLiteral("charging_only"));
+    QCOMPARE(spy.count(), 1);
+
+    // The first occurrence determines the order
+    slot.deliver(QStringLiteral(" mtp_mode,developer_mode ,mtp_mode,\t"
+        "charging_only,developer_mode, "));
+    QCOMPARE(spy.count(), 1);
+
+    slot.deliver(QStringLiteral("charging_only,mtp_mode,developer_mode,mtp_mode"));
+    QCOMPARE(usbModed.supportedModes(), QStringList() << QStringLiteral("charging_only")
+        << QStringLiteral("mtp_mode") << QStringLiteral("developer_mode"));
+    QCOMPARE(spy.count(), 2);
+
+    // Long lists take a different path, the result must be the same
+    QStringList modes;
+    for (int i=0; i<40; i++) {
+        modes.append(QStringLiteral("mode_%1").arg(i));
+    }
+    slot.deliver(modes.join(QLatin1Char(',')) + QLatin1Char(',') + modes.join(QLatin1Char(',')));
+    QCOMPARE(usbModed.supportedModes(), modes);
+    QCOMPARE(spy.count(), 3);
+    slot.deliver(modes.join(QStringLiteral(" , ")));
+    QCOMPARE(spy.count(), 3);
+}
+
+void StressModes::updates_data()
+{
+    QTest::addColumn<int>("vocabulary");
+    QTest::addColumn<int>("maxLength");
+    QTest::newRow("short lists") << 8 << 12;
+    QTest::newRow("long lists") << 64 << 200;
+}
+
+void StressModes::updates()
+{
+    static const int Instances = 8;
+    static const int Iterations = 20000;
+    static const char* const Slots[] = {
+        "onUsbSupportedModesChanged(QString)",
+        "onUsbHiddenModesChanged(QString)"
+    };
+    static const char* const Signals[] = {
+        SIGNAL(supportedModesChanged()),
+        SIGNAL(hiddenModesChanged())
+    };
+    QStringList (QUsbModed::*const Getters[])() const = {
+        &QUsbModed::supportedModes,
+        &QUsbModed::hiddenModes
+    };
+
+    QFETCH(int, vocabulary);
+    QFETCH(int, maxLength);
+
+    // The spies are owned by the instances, the instances by the test
+    QList<QUsbModed*> instances;
+    QList<ModeSlot> slotList;
+    QList<QSignalSpy*> spies;
+    for (int i=0; i<Instances; i++) {
+        QUsbModed* usbModed = new QUsbModed(iBus, this);
+        instances.append(usbModed);
+        for (int k=0; k<2; k++) {
+            QSignalSpy* spy = new QSignalSpy(usbModed, Signals[k]);
+            spy->setParent(usbModed);
+            spies.append(spy);
+            slotList.append(ModeSlot(usbModed, Slots[k]));
+            QVERIFY(slotList.last().isValid());
+        }
+    }
+
+    int changes = 0;
+    qint64 total = 0;
+    qint64 worst = 0;
+    QElapsedTimer timer;
+    for (int i=0; i<Iterations; i++) {
+        const int k = random() % 2;
+        const int index = (random() % Instances) * 2 + k;
+        QUsbModed* usbModed = instances.at(index / 2);
+        QSignalSpy* spy = spies.at(index);
+        const QStringList before((usbModed->*Getters[k])());
+        const QString input((random() % 3) ? generate(vocabulary, maxLength) :
+            reformat(before));
+
+        timer.start();
+        slotList.at(index).deliver(input);
+        const qint64 ns = timer.nsecsElapsed();
+        total += ns;
+        worst = qMax(worst, ns);
+
+        const QStringList after((usbModed->*Getters[k])());
+        const QString error(ModeList::check(after));
+        QVERIFY2(error.isEmpty(), qPrintable(error));
+        QCOMPARE(after, ModeList::parse(input));
+        QCOMPARE(spy->count(), (after != before) ? 1 : 0);
+        changes += spy->count();
+        spy->clear();
+    }
+
+    qDeleteAll(instances);
+    qInfo("%d updates, %d changes: %lld ns average, %lld ns worst case",
+        Iterations, changes, total / Iterations, worst);
+}
+
+QTEST_GUILESS_MAIN(StressModes)
+
+#include "stress_modes.moc"
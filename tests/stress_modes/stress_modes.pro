@@ -0,0 +1,8 @@
+TEMPLATE = app
+TARGET = stress_modes
+CONFIG += testcase
+
+include(../common/common.pri)
+
+SOURCES += \
+    stress_modes.cpp
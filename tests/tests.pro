@@ -0,0 +1,8 @@
+TEMPLATE = subdirs
+SUBDIRS += \
+    bench_pool \
+    bench_qusbmoded \
+    fuzz_modes \
+    stress_modes \
+    ut_qusbmoded \
+    ut_qusbmodedpool
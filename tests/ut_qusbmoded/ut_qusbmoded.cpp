@@ -0,0 +1,263 @@
+/*
+ * Copyright (C) 2026 Jolla Ltd.
+ *
+ * You may use this file under the terms of the BSD license as follows:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in
+ *     the documentation and/or other materials provided with the
+ *     distribution.
+ *   * Neither the name of Nemo Mobile nor the names of its contributors
+ *     may be used to endorse or promote products derived from this
+ *     software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "qusbmoded.h"
+#include "qusbmodedclock.h"
+
+#include "modelist.h"
+#include "testbus.h"
+#include "testusbmoded.h"
+
+#include <QElapsedTimer>
+#include <QSignalSpy>
+#include <QtTest>
+
+// Faster than QTRY_COMPARE, which polls in 50 ms steps
+static bool waitForCount(QSignalSpy &aSpy, int aCount)
+{
+    while (aSpy.count() < aCount) {
+        if (!aSpy.wait(5000)) {
+            return false;
+        }
+    }
+    return aSpy.count() == aCount;
+}
+
+// Timing dependent behaviour of QUsbModed, driven by a simulated clock
+class UtQUsbModed : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void simulatedClock();
+    void debounce();
+    void switchTimeout();
+    void switchBeforeTimeout();
+    void plugSwitchUnplug();
+};
+
+void UtQUsbModed::simulatedClock()
+{
+    QUsbModedSimulatedClock clock;
+    QScopedPointer<QUsbModedTimer> timer1(clock.createTimer(nullptr));
+    QScopedPointer<QUsbModedTimer> timer2(clock.createTimer(nullptr));
+    QScopedPointer<QUsbModedTimer> timer3(clock.createTimer(nullptr));
+    QStringList fired;
+    connect(timer1.data(), &QUsbModedTimer::timeout, [&fired]() { fired << QStringLiteral("1"); });
+    connect(timer2.data(), &QUsbModedTimer::timeout, [&fired]() { fired << QStringLiteral("2"); });
+    connect(timer3.data(), &QUsbModedTimer::timeout, [&fired]() { fired << QStringLiteral("3"); });
+
+    QCOMPARE(clock.now(), Q_INT64_C(0));
+    timer1->start(300);
+    timer2->start(100);
+    timer3->start(200);
+    QCOMPARE(clock.activeTimerCount(), 3);
+    timer3->stop();
+    QVERIFY(!timer3->isActive());
+    QCOMPARE(clock.activeTimerCount(), 2);
+
+    clock.advance(99);
+    QVERIFY(fired.isEmpty());
+    QCOMPARE(clock.now(), Q_INT64_C(99));
+    clock.advance(1);
+    QCOMPARE(fired, QStringList() << QStringLiteral("2"));
+    QVERIFY(!timer2->isActive());
+
+    // Jumps straight to the next deadline
+    QVERIFY(clock.runNext());
+    QCOMPARE(fired, QStringList() << QStringLiteral("2") << QStringLiteral("1"));
+    QCOMPARE(clock.now(), Q_INT64_C(300));
+    QVERIFY(!clock.runNext());
+    QCOMPARE(clock.activeTimerCount(), 0);
+}
+
+void UtQUsbModed::debounce()
+{
+    // usb_moded isn't needed, the events go straight to the slot
+    QUsbModedSimulatedClock clock;
+    QUsbModed usbModed(QDBusConnection(QStringLiteral("debounce")));
+    usbModed.setClock(&clock);
+    usbModed.setSettleTimes(500, 1000);
+    ModeSlot event(&usbModed, "onUsbEventReceived(QString)");
+    QVERIFY(event.isValid());
+    QSignalSpy connectedChanged(&usbModed, &QUsbModed::debouncedConnectedChanged);
+    QSignalSpy flapsChanged(&usbModed, &QUsbModed::suppressedFlapsChanged);
+
+    event.deliver(QUsbMode::Mode::Connected);
+    clock.advance(499);
+    QVERIFY(!usbModed.debouncedConnected());
+    QCOMPARE(connectedChanged.count(), 0);
+    clock.advance(1);
+    QVERIFY(usbModed.debouncedConnected());
+    QCOMPARE(connectedChanged.count(), 1);
+
+    // Disconnect that doesn't last long enough
+    event.deliver(QUsbMode::Mode::Disconnected);
+    clock.advance(999);
+    event.deliver(QUsbMode::Mode::Connected);
+    QCOMPARE(usbModed.suppressedFlaps(), 1);
+    QCOMPARE(flapsChanged.count(), 1);
+    clock.advance(5000);
+    QVERIFY(usbModed.debouncedConnected());
+    QCOMPARE(connectedChanged.count(), 1);
+
+    // And one that does
+    event.deliver(QUsbMode::Mode::Disconnected);
+    clock.advance(1000);
+    QVERIFY(!usbModed.debouncedConnected());
+    QCOMPARE(connectedChanged.count(), 2);
+    QCOMPARE(usbModed.suppressedFlaps(), 1);
+    QCOMPARE(clock.activeTimerCount(), 0);
+}
+
+void UtQUsbModed::switchTimeout()
+{
+    TestBus bus;
+    if (!bus.start()) {
+        QSKIP("dbus-daemon is not available");
+    }
+    TestUsbModed stub(bus.connect(QStringLiteral("usbmoded")));
+    QVERIFY(stub.registerService());
+    stub.setSupportedModes(QStringList() << QUsbMode::Mode::MTP);
+    stub.setAutoSwitch(false);
+
+    QUsbModedSimulatedClock clock;
+    QUsbModed usbModed(bus.connect(QStringLiteral("client")));
+    usbModed.setClock(&clock);
+    QTRY_VERIFY(usbModed.available());
+
+    // usb_moded takes the request but never gets there
+    QSignalSpy finished(&usbModed, &QUsbModed::modeSwitchFinished);
+    QVERIFY(usbModed.switchMode(QUsbMode::Mode::MTP, 3000));
+    QTRY_COMPARE(stub.callCount(QStringLiteral("set_mode")), 1);
+    QTRY_COMPARE(usbModed.targetMode(), QUsbMode::Mode::MTP);
+    clock.advance(2999);
+    QVERIFY(usbModed.modeSwitchPending());
+    QCOMPARE(finished.count(), 0);
+    clock.advance(1);
+    QVERIFY(!usbModed.modeSwitchPending());
+    QCOMPARE(finished.count(), 1);
+    QCOMPARE(finished.at(0).at(0).toString(), QUsbMode::Mode::MTP);
+    QCOMPARE(qvariant_cast<QUsbModed::ModeSwitchResult>(finished.at(0).at(1)),
+        QUsbModed::ModeSwitchTimedOut);
+
+    // Reaching the mode afterwards doesn't finish it again
+    stub.setCurrentState(QUsbMode::Mode::MTP);
+    QTRY_COMPARE(usbModed.currentMode(), QUsbMode::Mode::MTP);
+    QCOMPARE(finished.count(), 1);
+}
+
+void UtQUsbModed::switchBeforeTimeout()
+{
+    TestBus bus;
+    if (!bus.start()) {
+        QSKIP("dbus-daemon is not available");
+    }
+    TestUsbModed stub(bus.connect(QStringLiteral("usbmoded")));
+    QVERIFY(stub.registerService());
+    stub.setSupportedModes(QStringList() << QUsbMode::Mode::MTP);
+
+    QUsbModedSimulatedClock clock;
+    QUsbModed usbModed(bus.connect(QStringLiteral("client")));
+    usbModed.setClock(&clock);
+    QTRY_VERIFY(usbModed.available());
+
+    // The clock doesn't move, so this can't be a timeout
+    QSignalSpy finished(&usbModed, &QUsbModed::modeSwitchFinished);
+    QVERIFY(usbModed.switchMode(QUsbMode::Mode::MTP, 3000));
+    QTRY_COMPARE(finished.count(), 1);
+    QCOMPARE(qvariant_cast<QUsbModed::ModeSwitchResult>(finished.at(0).at(1)),
+        QUsbModed::ModeSwitchSucceeded);
+    QCOMPARE(clock.activeTimerCount(), 0);
+    clock.advance(10000);
+    QCOMPARE(finished.count(), 1);
+}
+
+void UtQUsbModed::plugSwitchUnplug()
+{
+    // The whole cable and mode switch cycle against the stand-in, over
+    // and over again. Settle times pass without anyone waiting for them.
+    static const int Iterations = 1000;
+    TestBus bus;
+    if (!bus.start()) {
+        QSKIP("dbus-daemon is not available");
+    }
+    TestUsbModed stub(bus.connect(QStringLiteral("usbmoded")));
+    QVERIFY(stub.registerService());
+    stub.setSupportedModes(QStringList() << QUsbMode::Mode::MTP);
+
+    QUsbModedSimulatedClock clock;
+    QUsbModed usbModed(bus.connect(QStringLiteral("client")));
+    usbModed.setClock(&clock);
+    usbModed.setSettleTimes(500, 1000);
+    QTRY_VERIFY(usbModed.available());
+
+    QSignalSpy events(&usbModed, &QUsbModed::eventReceived);
+    QSignalSpy states(&usbModed, &QUsbModed::currentModeChanged);
+    QSignalSpy finished(&usbModed, &QUsbModed::modeSwitchFinished);
+    QSignalSpy connected(&usbModed, &QUsbModed::debouncedConnectedChanged);
+    QElapsedTimer timer;
+    timer.start();
+    for (int i=0; i<Iterations; i++) {
+        stub.sendEvent(QUsbMode::Mode::Connected);
+        QVERIFY(waitForCount(events, 2*i + 1));
+        clock.advance(500);
+        QVERIFY(usbModed.debouncedConnected());
+
+        QVERIFY(usbModed.switchMode(QUsbMode::Mode::MTP, 3000));
+        QVERIFY(waitForCount(finished, i + 1));
+        QCOMPARE(qvariant_cast<QUsbModed::ModeSwitchResult>(finished.last().at(1)),
+            QUsbModed::ModeSwitchSucceeded);
+        QCOMPARE(usbModed.currentMode(), QUsbMode::Mode::MTP);
+
+        stub.sendEvent(QUsbMode::Mode::Disconnected);
+        stub.setCurrentState(QUsbMode::Mode::Undefined);
+        QVERIFY(waitForCount(events, 2*i + 2));
+        while (usbModed.currentMode() != QUsbMode::Mode::Undefined) {
+            QVERIFY(states.wait(5000));
+        }
+        clock.advance(1000);
+        QVERIFY(!usbModed.debouncedConnected());
+    }
+    const qint64 elapsed = qMax(timer.elapsed(), Q_INT64_C(1));
+
+    QCOMPARE(connected.count(), 2 * Iterations);
+    QCOMPARE(usbModed.suppressedFlaps(), 0);
+    QCOMPARE(clock.activeTimerCount(), 0);
+    qInfo("%d plug/switch/unplug cycles in %lld ms, %.0f per second",
+        Iterations, elapsed, Iterations * 1000.0 / elapsed);
+}
+
+QTEST_MAIN(UtQUsbModed)
+
+#include "ut_qusbmoded.moc"
@@ -0,0 +1,8 @@
+TEMPLATE = app
+TARGET = ut_qusbmoded
+CONFIG += testcase
+
+include(../common/common.pri)
+
+SOURCES += \
+    ut_qusbmoded.cpp
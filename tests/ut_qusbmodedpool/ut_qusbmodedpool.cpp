@@ -0,0 +1,172 @@
+/*
+ * Copyright (C) 2026 Jolla Ltd.
+ *
+ * You may use this file under the terms of the BSD license as follows:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in
+ *     the documentation and/or other materials provided with the
+ *     distribution.
+ *   * Neither the name of Nemo Mobile nor the names of its contributors
+ *     may be used to endorse or promote products derived from this
+ *     software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "qusbmodedpool.h"
+#include "qusbmodedclock.h"
+
+#include "testbus.h"
+#include "testusbmoded.h"
+
+#include <QSignalSpy>
+#include <QtTest>
+
+static bool hasChange(const QSignalSpy &aSpy, const QString &aProperty,
+    const QVariant &aValue)
+{
+    for (int i=0; i<aSpy.count(); i++) {
+        const QList<QVariant> args(aSpy.at(i));
+        if (args.at(1).toString() == aProperty && args.at(2) == aValue) {
+            return true;
+        }
+    }
+    return false;
+}
+
+class UtQUsbModedPool : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void startupTimeout();
+    void setCurrentMode();
+    void connectFailure();
+    void readdEndpoint();
+};
+
+void UtQUsbModedPool::startupTimeout()
+{
+    TestBus hungBus, bus;
+    if (!hungBus.start() || !bus.start()) {
+        QSKIP("dbus-daemon is not available");
+    }
+    TestUsbModed hung(hungBus.connect(QStringLiteral("hung")));
+    TestUsbModed usbModed(bus.connect(QStringLiteral("usbmoded")));
+    QVERIFY(hung.registerService());
+    QVERIFY(usbModed.registerService());
+    hung.setHung(true);
+
+    // The hung endpoint must not keep the other one from starting
+    QUsbModedSimulatedClock clock;
+    QUsbModedPool pool(1);
+    pool.setClock(&clock);
+    pool.setStartupBatchSize(1);
+    pool.setStartupTimeout(200);
+    QSignalSpy failed(&pool, &QUsbModedPool::endpointFailed);
+    QSignalSpy ready(&pool, &QUsbModedPool::endpointReady);
+    QVERIFY(pool.addEndpoint(QStringLiteral("hung"), hungBus.address()));
+    QVERIFY(pool.addEndpoint(QStringLiteral("ok"), bus.address()));
+
+    clock.advance(199);
+    QCOMPARE(failed.count(), 0);
+    QCOMPARE(ready.count(), 0);
+    clock.advance(1);
+    QCOMPARE(failed.count(), 1);
+    QCOMPARE(failed.at(0).at(0).toString(), QStringLiteral("hung"));
+    QTRY_COMPARE(ready.count(), 1);
+    QCOMPARE(ready.at(0).at(0).toString(), QStringLiteral("ok"));
+    QVERIFY(!pool.isReady(QStringLiteral("hung")));
+    QVERIFY(pool.isReady(QStringLiteral("ok")));
+
+    // It still gets there once usb_moded recovers, without being
+    // reported as failed again
+    hung.setHung(false);
+    QTRY_COMPARE(ready.count(), 2);
+    QCOMPARE(pool.readyCount(), 2);
+    QCOMPARE(failed.count(), 1);
+    QCOMPARE(clock.activeTimerCount(), 0);
+}
+
+void UtQUsbModedPool::setCurrentMode()
+{
+    TestBus bus;
+    if (!bus.start()) {
+        QSKIP("dbus-daemon is not available");
+    }
+    TestUsbModed usbModed(bus.connect(QStringLiteral("usbmoded")));
+    QVERIFY(usbModed.registerService());
+
+    QUsbModedPool pool(1);
+    QSignalSpy changed(&pool, &QUsbModedPool::changed);
+    QVERIFY(!pool.setCurrentMode(QStringLiteral("foo"), QUsbMode::Mode::MTP));
+    QVERIFY(pool.addEndpoint(QStringLiteral("foo"), bus.address()));
+    QTRY_VERIFY(pool.isReady(QStringLiteral("foo")));
+
+    changed.clear();
+    QVERIFY(pool.setCurrentMode(QStringLiteral("foo"), QUsbMode::Mode::MTP));
+    QTRY_COMPARE(usbModed.callCount(QStringLiteral("set_mode")), 1);
+    QTRY_VERIFY(hasChange(changed, QStringLiteral("currentMode"),
+        QUsbMode::Mode::MTP));
+}
+
+void UtQUsbModedPool::connectFailure()
+{
+    QUsbModedPool pool(1);
+    QSignalSpy failed(&pool, &QUsbModedPool::endpointFailed);
+    QVERIFY(pool.addEndpoint(QStringLiteral("foo"),
+        QStringLiteral("unix:path=/nonexistent/bus")));
+    QTRY_COMPARE(failed.count(), 1);
+
+    // Nothing there to take the call
+    QVERIFY(!pool.setCurrentMode(QStringLiteral("foo"), QUsbMode::Mode::MTP));
+    QCOMPARE(pool.readyCount(), 0);
+}
+
+void UtQUsbModedPool::readdEndpoint()
+{
+    TestBus oldBus, newBus;
+    if (!oldBus.start() || !newBus.start()) {
+        QSKIP("dbus-daemon is not available");
+    }
+    TestUsbModed oldUsbModed(oldBus.connect(QStringLiteral("usbmoded")));
+    TestUsbModed newUsbModed(newBus.connect(QStringLiteral("usbmoded")));
+    QVERIFY(oldUsbModed.registerService());
+    QVERIFY(newUsbModed.registerService());
+
+    // Same name on another bus, most likely on another thread while the
+    // old instance is still being stopped
+    QUsbModedPool pool(2);
+    QVERIFY(pool.addEndpoint(QStringLiteral("foo"), oldBus.address()));
+    QTRY_VERIFY(pool.isReady(QStringLiteral("foo")));
+    QVERIFY(pool.removeEndpoint(QStringLiteral("foo")));
+    QVERIFY(pool.addEndpoint(QStringLiteral("foo"), newBus.address()));
+    QTRY_VERIFY(pool.isReady(QStringLiteral("foo")));
+    QCOMPARE(pool.readyCount(), 1);
+
+    QVERIFY(pool.setCurrentMode(QStringLiteral("foo"), QUsbMode::Mode::MTP));
+    QTRY_COMPARE(newUsbModed.callCount(QStringLiteral("set_mode")), 1);
+    QCOMPARE(oldUsbModed.callCount(QStringLiteral("set_mode")), 0);
+}
+
+QTEST_MAIN(UtQUsbModedPool)
+
+#include "ut_qusbmodedpool.moc"
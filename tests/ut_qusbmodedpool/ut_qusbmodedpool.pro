@@ -0,0 +1,8 @@
+TEMPLATE = app
+TARGET = ut_qusbmodedpool
+CONFIG += testcase
+
+include(../common/common.pri)
+
+SOURCES += \
+    ut_qusbmodedpool.cpp